@@ -1,12 +1,231 @@
 ﻿#include "jsonpp.hpp"
+#include <algorithm>
 #include <cctype>
+#include <cerrno>
+#include <climits>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <cfloat>
+#include <cmath>
+#include <exception>
 #include <fstream>
+#include <limits>
+#include <locale>
+#include <mutex>
+#include <queue>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+#if defined(__AVX2__)
+#define JSONPP_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define JSONPP_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace json {
     
     parse_exception::parse_exception(const std::string& msg)
         : std::runtime_error(msg) {}
 
+    bool operator==(StringView lhs, StringView rhs)
+    {
+        return lhs.size() == rhs.size() && (lhs.empty() || std::memcmp(lhs.data(), rhs.data(), lhs.size()) == 0);
+    }
+
+    bool operator!=(StringView lhs, StringView rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+    namespace detail {
+
+        Arena::Arena(size_t firstChunkSize)
+            : _chunk(nullptr), _cursor(nullptr), _end(nullptr), _nextChunkSize(firstChunkSize) {}
+
+        Arena::~Arena()
+        {
+            while (_chunk != nullptr) {
+                auto previous = _chunk->previous;
+                ::operator delete(_chunk);
+                _chunk = previous;
+            }
+        }
+
+        void Arena::grow(size_t minimumSize)
+        {
+            auto size = std::max(_nextChunkSize, minimumSize + sizeof(Chunk));
+            auto chunk = static_cast<Chunk*>(::operator new(size));
+            chunk->previous = _chunk;
+            chunk->end = reinterpret_cast<char*>(chunk) + size;
+            _chunk = chunk;
+            _cursor = reinterpret_cast<char*>(chunk + 1);
+            _end = reinterpret_cast<char*>(chunk) + size;
+            _nextChunkSize *= 2;
+        }
+
+        void* Arena::allocate(size_t size, size_t alignment)
+        {
+            auto padding = (alignment - reinterpret_cast<std::uintptr_t>(_cursor) % alignment) % alignment;
+            if (_cursor == nullptr || static_cast<size_t>(_end - _cursor) < padding + size) {
+                grow(size + alignment);
+                padding = (alignment - reinterpret_cast<std::uintptr_t>(_cursor) % alignment) % alignment;
+            }
+            auto p = _cursor + padding;
+            _cursor = p + size;
+            return p;
+        }
+
+        bool Arena::owns(const void* p) const
+        {
+            // the chunks double in size so there are only ever a few of them, newest first
+            const auto address = reinterpret_cast<std::uintptr_t>(p);
+            for (auto chunk = _chunk; chunk != nullptr; chunk = chunk->previous) {
+                if (address >= reinterpret_cast<std::uintptr_t>(chunk + 1) && address < reinterpret_cast<std::uintptr_t>(chunk->end)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        char* Arena::copy(StringView str)
+        {
+            auto p = static_cast<char*>(allocate(str.size(), 1));
+            if (!str.empty()) {
+                std::memcpy(p, str.data(), str.size());
+            }
+            return p;
+        }
+
+        // FNV-1a
+        std::uint32_t hashKey(StringView key)
+        {
+            std::uint32_t hash = 2166136261u;
+            for (auto c : key) {
+                hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+            }
+            return hash;
+        }
+
+        // objects with fewer members are searched linearly, which beats hashing the name
+        const size_t HASH_INDEX_THRESHOLD = 16;
+    }
+
+    KeyTable::KeyTable()
+        : _slots(64, nullptr), _size(0) {}
+
+    const detail::KeyEntry* KeyTable::lookup(StringView name, std::uint32_t hash) const
+    {
+        auto mask = _slots.size() - 1;
+        for (auto i = hash & mask; _slots[i] != nullptr; i = (i + 1) & mask) {
+            auto entry = _slots[i];
+            if (entry->hash == hash && InternedKey(entry).name() == name) {
+                return entry;
+            }
+        }
+        return nullptr;
+    }
+
+    InternedKey KeyTable::find(StringView name) const
+    {
+        auto hash = detail::hashKey(name);
+        std::shared_lock<std::shared_timed_mutex> lock(_mutex);
+        return InternedKey(lookup(name, hash));
+    }
+
+    InternedKey KeyTable::intern(StringView name)
+    {
+        if (name.size() > std::numeric_limits<std::uint32_t>::max()) {
+            throw std::length_error("The key is too long to be interned.");
+        }
+
+        auto hash = detail::hashKey(name);
+        {
+            // most keys are already there, which only needs a shared lock
+            std::shared_lock<std::shared_timed_mutex> lock(_mutex);
+            auto entry = lookup(name, hash);
+            if (entry != nullptr) {
+                return InternedKey(entry);
+            }
+        }
+
+        std::lock_guard<std::shared_timed_mutex> lock(_mutex);
+        auto entry = lookup(name, hash);
+        if (entry != nullptr) {
+            return InternedKey(entry);
+        }
+
+        auto memory = static_cast<char*>(_entries.allocate(sizeof(detail::KeyEntry) + name.size(), alignof(detail::KeyEntry)));
+        auto newEntry = new (memory) detail::KeyEntry{ this, hash, static_cast<std::uint32_t>(name.size()) };
+        std::copy(name.begin(), name.end(), memory + sizeof(detail::KeyEntry));
+
+        if ((_size + 1) * 2 > _slots.size()) {
+            std::vector<const detail::KeyEntry*> slots(_slots.size() * 2, nullptr);
+            auto mask = slots.size() - 1;
+            for (auto e : _slots) {
+                if (e != nullptr) {
+                    auto i = e->hash & mask;
+                    while (slots[i] != nullptr) {
+                        i = (i + 1) & mask;
+                    }
+                    slots[i] = e;
+                }
+            }
+            _slots.swap(slots);
+        }
+
+        auto mask = _slots.size() - 1;
+        auto i = hash & mask;
+        while (_slots[i] != nullptr) {
+            i = (i + 1) & mask;
+        }
+        _slots[i] = newEntry;
+        ++_size;
+        return InternedKey(newEntry);
+    }
+
+    size_t KeyTable::size() const
+    {
+        std::shared_lock<std::shared_timed_mutex> lock(_mutex);
+        return _size;
+    }
+
+    void* Value::operator new(size_t size)
+    {
+        return ::operator new(size);
+    }
+
+    void* Value::operator new(size_t size, detail::Arena& arena)
+    {
+        return arena.allocate(size, alignof(std::max_align_t));
+    }
+
+    void Value::operator delete(void* p)
+    {
+        ::operator delete(p);
+    }
+
+    void Value::operator delete(void*, detail::Arena&)
+    {
+        // arena memory is released with the arena
+    }
+
     bool Value::isType(ValueType type) const
     {
         return _type == type;
@@ -45,757 +264,5805 @@ namespace json {
         return isType(ValueType::BOOL);
     }
 
-    Object::Object()
-        : Value(Value::ValueType::OBJECT) {}
+    namespace detail {
 
-    Value* Object::getValue(const std::string& name) const
-    {
-        auto it = _values.find(name);
-        if (it != _values.end()) {
-            auto& value = it->second;
-            return value.get();
-        }
+        const size_t NOT_FOUND = static_cast<size_t>(-1);
 
-        // recursively search for the value in child values that are objects
-        for (auto& p : _values) {
-            auto& value = p.second;
-            if (value->isObject()) {
-                return static_cast<Object*>(value.get())->getValue(name);
+        // A slot of the open addressing hash index over the names of a shape
+        struct ShapeSlot {
+            std::uint32_t hash;
+            std::uint32_t member; // the index of the name plus one, zero for an empty slot
+        };
+
+        /**
+         * The names of an object in insertion order. Small shapes are searched linearly and bigger ones through the hash index.
+         */
+        class Shape {
+        public:
+            Shape(Arena* arena, ShapeTable* table, bool interned)
+                : table(table), interned(interned), names(ArenaAllocator<StringView>(arena)), index(ArenaAllocator<ShapeSlot>(arena)) {}
+
+            ShapeTable* table; // null for a shape owned by a single object
+            bool interned; // whether the names come from a KeyTable
+            std::vector<StringView, ArenaAllocator<StringView>> names;
+            std::vector<ShapeSlot, ArenaAllocator<ShapeSlot>> index;
+            std::vector<std::pair<InternedKey, Shape*>> transitions; // guarded by the mutex of the table
+
+            size_t find(StringView name, std::uint32_t hash) const
+            {
+                if (index.empty()) {
+                    for (size_t i = 0; i < names.size(); ++i) {
+                        if (names[i] == name) {
+                            return i;
+                        }
+                    }
+                    return NOT_FOUND;
+                }
+
+                auto mask = index.size() - 1;
+                for (auto i = hash & mask; index[i].member != 0; i = (i + 1) & mask) {
+                    auto member = index[i].member - 1;
+                    if (index[i].hash == hash && names[member] == name) {
+                        return member;
+                    }
+                }
+                return NOT_FOUND;
+            }
+
+            // Only for interned shapes, whose names are compared by address
+            size_t find(InternedKey key) const
+            {
+                auto data = key.name().data();
+                if (index.empty()) {
+                    for (size_t i = 0; i < names.size(); ++i) {
+                        if (names[i].data() == data) {
+                            return i;
+                        }
+                    }
+                    return NOT_FOUND;
+                }
+
+                auto mask = index.size() - 1;
+                for (auto i = key.hash() & mask; index[i].member != 0; i = (i + 1) & mask) {
+                    if (names[index[i].member - 1].data() == data) {
+                        return index[i].member - 1;
+                    }
+                }
+                return NOT_FOUND;
+            }
+
+            std::uint32_t hashOf(StringView name) const
+            {
+                if (interned) {
+                    // the name is preceded by its entry in the key table, which has the hash already
+                    return (reinterpret_cast<const KeyEntry*>(name.data()) - 1)->hash;
+                }
+                return hashKey(name);
+            }
+
+            void add(StringView name, std::uint32_t hash)
+            {
+                names.push_back(name);
+
+                // the index is kept at most half full so probe sequences stay short
+                if (index.empty()) {
+                    if (names.size() == HASH_INDEX_THRESHOLD) {
+                        buildIndex(HASH_INDEX_THRESHOLD * 4);
+                    }
+                } else if (names.size() * 2 > index.size()) {
+                    buildIndex(index.size() * 2);
+                } else {
+                    indexName(hash, names.size() - 1);
+                }
+            }
+        private:
+            void indexName(std::uint32_t hash, size_t member)
+            {
+                auto mask = index.size() - 1;
+                auto i = hash & mask;
+                while (index[i].member != 0) {
+                    i = (i + 1) & mask;
+                }
+                index[i] = { hash, static_cast<std::uint32_t>(member + 1) };
+            }
+
+            void buildIndex(size_t slots)
+            {
+                index.assign(slots, ShapeSlot{ 0, 0 });
+                for (size_t i = 0; i < names.size(); ++i) {
+                    indexName(hashOf(names[i]), i);
+                }
             }
+        };
+
+        const char* copyKey(Arena* arena, StringView name)
+        {
+            if (arena != nullptr) {
+                return arena->copy(name);
+            }
+            auto key = new char[name.size()];
+            std::copy(name.begin(), name.end(), key);
+            return key;
         }
-        return nullptr;
     }
 
-    void Object::addValue(const std::string& name, std::unique_ptr<Value> value)
+    const size_t ShapeTable::MAX_MEMBERS;
+    const size_t ShapeTable::MAX_SHAPES;
+
+    ShapeTable::ShapeTable(std::shared_ptr<KeyTable> keys)
+        : _keys(std::move(keys))
     {
-        _values.emplace(name, std::move(value));
+        _shapes.push_back(std::make_unique<detail::Shape>(nullptr, this, true));
     }
 
-    std::map<std::string, Value*> Object::getValues() const
+    ShapeTable::~ShapeTable() {}
+
+    const std::shared_ptr<KeyTable>& ShapeTable::getKeys() const
     {
-        std::map<std::string, Value*> values;
-        for (const auto& p : _values) {
-            auto& val = p.second;
-            values.emplace(p.first, val.get());
-        }
-        return values;
+        return _keys;
     }
 
-    size_t Object::size() const
+    size_t ShapeTable::size() const
     {
-        return _values.size();
+        std::shared_lock<std::shared_timed_mutex> lock(_mutex);
+        return _shapes.size() - 1;
     }
 
-    Object* Object::getObjectValue(const std::string& name) const
+    detail::Shape* ShapeTable::transition(detail::Shape* from, InternedKey name)
     {
-        auto value = getValue(name);
-        if (value == nullptr || !value->isObject()) {
-            return nullptr;
+        {
+            // most objects follow a layout that was seen before, which only needs a shared lock
+            std::shared_lock<std::shared_timed_mutex> lock(_mutex);
+            if (from == nullptr) {
+                from = _shapes.front().get();
+            }
+            for (auto& t : from->transitions) {
+                if (t.first == name) {
+                    return t.second;
+                }
+            }
         }
-        return static_cast<Object*>(value);
-    }
 
-    Array* Object::getArrayValue(const std::string& name) const
-    {
-        auto value = getValue(name);
-        if (value == nullptr || !value->isArray()) {
+        std::lock_guard<std::shared_timed_mutex> lock(_mutex);
+        for (auto& t : from->transitions) {
+            if (t.first == name) {
+                return t.second;
+            }
+        }
+        if (from->names.size() >= MAX_MEMBERS || _shapes.size() > MAX_SHAPES) {
             return nullptr;
         }
-        return static_cast<Array*>(value);
+
+        auto shape = std::make_unique<detail::Shape>(nullptr, this, true);
+        shape->names = from->names;
+        shape->index = from->index;
+        shape->add(name.name(), name.hash());
+        from->transitions.emplace_back(name, shape.get());
+        _shapes.push_back(std::move(shape));
+        return _shapes.back().get();
     }
 
-    std::string Object::getStringValue(const std::string& name, const std::string& defaultValue) const
-    {
-        auto value = getValue(name);
-        if (value == nullptr || !value->isString()) {
-            return defaultValue;
+    Object::Object()
+        : Object(static_cast<detail::DocumentResources*>(nullptr)) {}
+
+    Object::Object(detail::DocumentResources* document)
+        : Value(Value::ValueType::OBJECT), _resources(document), _attachedTo(document), _shape(nullptr),
+          _values(detail::ArenaAllocator<std::unique_ptr<Value>>(document != nullptr ? document->arena.get() : nullptr)) {}
+
+    Object::Object(std::unique_ptr<detail::DocumentResources> document)
+        : Value(Value::ValueType::OBJECT), _document(std::move(document)), _resources(_document.get()), _attachedTo(_resources), _shape(nullptr),
+          _values(detail::ArenaAllocator<std::unique_ptr<Value>>(_resources->arena.get())) {}
+
+    namespace detail {
+
+        // Containers nested up to this deep are destroyed by plain recursion, which frees them in the order they were
+        // allocated and is the fastest way through an ordinary document
+        const size_t RECURSIVE_DESTROY_DEPTH = 256;
+
+        void releaseValue(std::unique_ptr<Value> value, Arena* arena)
+        {
+            // values added to a parsed document after parsing come from the heap, so ask the arena
+            if (arena != nullptr && value != nullptr && arena->owns(value.get())) {
+                value.release()->~Value();
+            }
         }
-        return static_cast<String*>(value)->getValue();
-    }
 
-    bool Object::getBoolValue(const std::string& name, bool defaultValue) const
-    {
-        auto value = getValue(name);
-        if (value == nullptr || !value->isBool()) {
-            return defaultValue;
+        void destroyValues(ValueList& values)
+        {
+            auto arena = values.get_allocator().arena;
+            static thread_local size_t depth = 0;
+            if (depth < RECURSIVE_DESTROY_DEPTH) {
+                ++depth;
+                for (auto& value : values) {
+                    releaseValue(std::move(value), arena);
+                }
+                --depth;
+                return;
+            }
+
+            // Deeper down the nested objects and arrays are moved out to a list of our own, each one after all of its
+            // own nested containers were moved out as well, so only scalars are left in a container when it goes.
+            std::vector<std::unique_ptr<Value>> pending;
+            auto takeContainers = [&pending](ValueList& from) {
+                for (auto& value : from) {
+                    if (value != nullptr && (value->isObject() || value->isArray())) {
+                        pending.push_back(std::move(value));
+                    }
+                }
+            };
+
+            for (auto& value : values) {
+                if (value == nullptr || !(value->isObject() || value->isArray())) {
+                    continue;
+                }
+                pending.push_back(std::move(value));
+                while (!pending.empty()) {
+                    auto container = std::move(pending.back());
+                    pending.pop_back();
+                    takeContainers(container->isObject() ? static_cast<Object*>(container.get())->_values : static_cast<Array*>(container.get())->_values);
+                    releaseValue(std::move(container), arena);
+                }
+            }
+            for (auto& value : values) {
+                releaseValue(std::move(value), arena);
+            }
         }
-        return static_cast<Bool*>(value)->getValue();
-    }
 
-    void* Object::getNullValue(const std::string& name) const
-    {
-        auto value = getValue(name);
-        if (value == nullptr || !value->isNull()) {
-            return nullptr;
+        void attachToDocument(Value* value, DocumentResources* document)
+        {
+            // the children of a container that was not attached to a document yet, null for anything else
+            auto attach = [document](Value* value) -> ValueList* {
+                if (value != nullptr && value->isObject()) {
+                    auto obj = static_cast<Object*>(value);
+                    if (obj->_attachedTo == nullptr) {
+                        obj->_attachedTo = document;
+                        return &obj->_values;
+                    }
+                } else if (value != nullptr && value->isArray()) {
+                    auto arr = static_cast<Array*>(value);
+                    if (arr->_attachedTo == nullptr) {
+                        arr->_attachedTo = document;
+                        return &arr->_values;
+                    }
+                }
+                return nullptr;
+            };
+
+            // values built by the parser already belong to the document, so this only walks subtrees built elsewhere
+            auto children = attach(value);
+            if (children == nullptr) {
+                return;
+            }
+            std::vector<ValueList*> pending{ children };
+            while (!pending.empty()) {
+                auto values = pending.back();
+                pending.pop_back();
+                for (auto& child : *values) {
+                    if (auto nested = attach(child.get())) {
+                        pending.push_back(nested);
+                    }
+                }
+            }
         }
-        return nullptr;
     }
 
-    double Object::getNumberValue(const std::string& name, double defaultValue) const
+    Object::~Object()
     {
-        auto value = getValue(name);
-        if (value == nullptr || !value->isNumber()) {
-            return defaultValue;
+        detail::destroyValues(_values);
+
+        if (_shape == nullptr || _shape->table != nullptr) {
+            return;
         }
-        return static_cast<Number*>(value)->getValue();
-    }
 
-    String::String(const std::string& value)
-        : Value(Value::ValueType::STRING), _value(value) {}
+        // the object owns its shape, and the names as well unless they live in the arena or a key table
+        if (arena() == nullptr && keys() == nullptr) {
+            for (auto name : _shape->names) {
+                delete[] name.data();
+            }
+        }
+        if (arena() != nullptr) {
+            _shape->~Shape();
+        } else {
+            delete _shape;
+        }
+    }
 
-    std::string String::getValue() const
+    detail::Arena* Object::arena() const
     {
-        return _value;
+        return _resources != nullptr ? _resources->arena.get() : nullptr;
     }
 
-    Array::Array()
-        : Value(Value::ValueType::ARRAY) {}
+    KeyTable* Object::keys() const
+    {
+        return _resources != nullptr ? _resources->keys.get() : nullptr;
+    }
 
-    void Array::addValue(std::unique_ptr<Value> value)
+    size_t Object::findSlot(StringView name) const
     {
-        _values.emplace_back(std::move(value));
+        if (_shape == nullptr) {
+            return detail::NOT_FOUND;
+        }
+        return _shape->find(name, _shape->index.empty() ? 0 : detail::hashKey(name));
     }
 
-    size_t Array::size() const
+    size_t Object::findSlot(InternedKey key) const
     {
-        return _values.size();
+        return _shape == nullptr ? detail::NOT_FOUND : _shape->find(key);
     }
 
-    std::vector<Value*> Array::getValues() const
+    detail::Shape* Object::ownShape()
     {
-        std::vector<Value*> values;
-        values.reserve(size());
-        for (const auto& v : _values) {
-            values.push_back(v.get());
+        auto a = arena();
+        detail::Shape* shape;
+        if (a != nullptr) {
+            shape = new (a->allocate(sizeof(detail::Shape), alignof(detail::Shape))) detail::Shape(a, nullptr, keys() != nullptr);
+        } else {
+            shape = new detail::Shape(nullptr, nullptr, keys() != nullptr);
         }
-        return values;
+
+        // a shared shape has interned names, which stay where they are
+        if (_shape != nullptr) {
+            for (auto name : _shape->names) {
+                shape->add(name, shape->hashOf(name));
+            }
+        }
+        _shape = shape;
+        return shape;
     }
 
-    Value* Array::getValue(size_t index) const
+    Value* Object::getValue(StringView name) const
     {
-        return _values.at(index).get();
+        auto slot = findSlot(name);
+        if (slot != detail::NOT_FOUND) {
+            return _values[slot].get();
+        }
+
+        // recursively search for the value in the first member that is an object
+        for (auto& value : _values) {
+            if (value->isObject()) {
+                return static_cast<Object*>(value.get())->getValue(name);
+            }
+        }
+        return nullptr;
     }
 
-    Object* Array::getObjectValue(size_t index) const
+    Value* Object::getOwnValue(StringView name) const
     {
-        auto value = getValue(index);
-        if (value == nullptr || !value->isObject()) {
-            return nullptr;
-        }
-        return static_cast<Object*>(value);
+        auto slot = findSlot(name);
+        return slot != detail::NOT_FOUND ? _values[slot].get() : nullptr;
     }
 
-    Array* Array::getArrayValue(size_t index) const
+    Value* Object::getValue(InternedKey key) const
     {
-        auto value = getValue(index);
-        if (value == nullptr || !value->isArray()) {
+        if (!key) {
             return nullptr;
         }
-        return static_cast<Array*>(value);
+        if (key.table() != keys()) {
+            return getValue(key.name());
+        }
+
+        auto slot = findSlot(key);
+        if (slot != detail::NOT_FOUND) {
+            return _values[slot].get();
+        }
+
+        // recursively search for the value in the first member that is an object
+        for (auto& value : _values) {
+            if (value->isObject()) {
+                return static_cast<Object*>(value.get())->getValue(key);
+            }
+        }
+        return nullptr;
     }
 
-    std::string Array::getStringValue(size_t index, const std::string& defaultValue) const
+    void Object::addValue(StringView name, std::unique_ptr<Value> value)
     {
-        auto value = getValue(index);
-        if (value == nullptr || !value->isString()) {
-            return defaultValue;
+        if (_attachedTo != nullptr) {
+            ++_attachedTo->generation;
+            detail::attachToDocument(value.get(), _attachedTo);
+        }
+
+        // a value from the arena that does not make it into the object must not be freed
+        try {
+            if (!addMember(name, value)) {
+                detail::releaseValue(std::move(value), arena());
+            }
+        } catch (...) {
+            detail::releaseValue(std::move(value), arena());
+            throw;
         }
-        return static_cast<String*>(value)->getValue();
     }
 
-    bool Array::getBoolValue(size_t index, bool defaultValue) const
+    bool Object::addMember(StringView name, std::unique_ptr<Value>& value)
     {
-        auto value = getValue(index);
-        if (value == nullptr || !value->isBool()) {
-            return defaultValue;
+        // the first value added under a name is kept
+        auto table = keys();
+        InternedKey interned;
+        if (table != nullptr) {
+            interned = table->intern(name);
+            if (findSlot(interned) != detail::NOT_FOUND) {
+                return false;
+            }
+        } else if (findSlot(name) != detail::NOT_FOUND) {
+            return false;
         }
-        return static_cast<Bool*>(value)->getValue();
-    }
 
-    double Array::getNumberValue(size_t index, double defaultValue) const
-    { 
-        auto value = getValue(index);
-        if (value == nullptr || !value->isNumber()) {
-            return defaultValue;
+        // follow the shared layouts for as long as there is one
+        auto shapes = _resources != nullptr ? _resources->shapes.get() : nullptr;
+        if (shapes != nullptr && (_shape == nullptr || _shape->table == shapes)) {
+            auto next = shapes->transition(_shape, interned);
+            if (next != nullptr) {
+                _values.push_back(std::move(value));
+                _shape = next;
+                return true;
+            }
         }
-        return static_cast<Number*>(value)->getValue();
+
+        auto shape = _shape != nullptr && _shape->table == nullptr ? _shape : ownShape();
+        if (table != nullptr) {
+            shape->add(interned.name(), interned.hash());
+        } else {
+            shape->add(StringView(detail::copyKey(arena(), name), name.size()), detail::hashKey(name));
+        }
+        _values.push_back(std::move(value));
+        return true;
     }
 
-    void* Array::getNullValue(size_t index) const
+    Object::Member Object::Iterator::operator*() const
     {
-        auto value = getValue(index);
-        if (value == nullptr || !value->isNull()) {
-            return nullptr;
+        return { _object->_shape->names[_index], _object->_values[_index].get() };
+    }
+
+    namespace detail {
+
+        struct KeyHash {
+            size_t operator()(StringView key) const { return hashKey(key); }
+        };
+
+        struct KeyIndex {
+            std::uint64_t generation;
+            std::unordered_map<StringView, std::vector<Value*>, KeyHash> values; // breadth first
+        };
+
+        DocumentResources::DocumentResources()
+            : indexKeys(false), generation(0) {}
+
+        DocumentResources::~DocumentResources() {}
+
+        // Calls visit(name, value) for every member below the object, breadth first, until it returns false
+        template <class F>
+        void visitBreadthFirst(const Object* root, F&& visit)
+        {
+            std::queue<const Value*> containers;
+            containers.push(root);
+            while (!containers.empty()) {
+                auto container = containers.front();
+                containers.pop();
+                if (container->isObject()) {
+                    for (auto member : *static_cast<const Object*>(container)) {
+                        if (!visit(member.name, member.value)) {
+                            return;
+                        }
+                        if (member.value->isObject() || member.value->isArray()) {
+                            containers.push(member.value);
+                        }
+                    }
+                } else {
+                    for (auto value : *static_cast<const Array*>(container)) {
+                        if (value->isObject() || value->isArray()) {
+                            containers.push(value);
+                        }
+                    }
+                }
+            }
         }
-        return nullptr;
     }
 
-    std::unique_ptr<Object> load(const std::string& filePath)
+    const std::vector<Value*>* Object::findIndexed(StringView name) const
     {
-        std::ifstream file(filePath);
-        if (!file.is_open()) {
-            throw std::runtime_error("Unable to open " + filePath + " to load JSON.");
+        std::lock_guard<std::mutex> lock(_resources->keyIndexMutex);
+        auto& index = _resources->keyIndex;
+        if (index == nullptr || index->generation != _resources->generation) {
+            index = std::make_unique<detail::KeyIndex>();
+            index->generation = _resources->generation;
+            detail::visitBreadthFirst(this, [&](StringView key, Value* value) {
+                index->values[key].push_back(value);
+                return true;
+            });
         }
 
-        std::string json, line;
-        while (std::getline(file, line)) {
-            json += line;
-            json += '\n';
-        }
-        return parse(json);
+        auto it = index->values.find(name);
+        return it != index->values.end() ? &it->second : nullptr;
     }
 
-    void write(const Object* obj, const std::string& filePath)
+    Value* Object::findValue(StringView name) const
     {
-        ValueWriter writer;
-        obj->accept(&writer);
-        auto str = writer.getString();
-
-        std::ofstream file(filePath);
-        if (!file.is_open()) {
-            throw std::runtime_error("Unable to open " + filePath + " to write JSON.");
+        // only the root knows that nothing else holds the document
+        if (_document != nullptr && _document->indexKeys) {
+            auto values = findIndexed(name);
+            return values != nullptr ? values->front() : nullptr;
         }
-        file << str;
+
+        Value* found = nullptr;
+        detail::visitBreadthFirst(this, [&](StringView key, Value* value) {
+            if (key == name) {
+                found = value;
+            }
+            return found == nullptr;
+        });
+        return found;
     }
 
-    std::unique_ptr<Object> parse(const std::string& text)
+    std::vector<Value*> Object::findValues(StringView name) const
     {
-        detail::Lexer lexer(text);
-        detail::Parser parser(lexer);
-        return parser.parse();
+        if (_document != nullptr && _document->indexKeys) {
+            auto values = findIndexed(name);
+            return values != nullptr ? *values : std::vector<Value*>();
+        }
+
+        std::vector<Value*> found;
+        detail::visitBreadthFirst(this, [&](StringView key, Value* value) {
+            if (key == name) {
+                found.push_back(value);
+            }
+            return true;
+        });
+        return found;
     }
 
-    void Object::accept(ValueVisitor* visitor) const
+    std::map<std::string, Value*> Object::getValues() const
     {
-        visitor->visit(this);
+        std::map<std::string, Value*> values;
+        for (size_t i = 0; i < _values.size(); ++i) {
+            values.emplace(_shape->names[i].str(), _values[i].get());
+        }
+        return values;
     }
 
-    void Array::accept(ValueVisitor* visitor) const
+    size_t Object::size() const
     {
-        visitor->visit(this);
+        return _values.size();
     }
 
-    void String::accept(ValueVisitor* visitor) const
+    Object* Object::getObjectValue(StringView name) const
     {
-        visitor->visit(this);
+        auto value = getValue(name);
+        if (value == nullptr || !value->isObject()) {
+            return nullptr;
+        }
+        return static_cast<Object*>(value);
     }
 
-    void Bool::accept(ValueVisitor* visitor) const
+    Array* Object::getArrayValue(StringView name) const
     {
-        visitor->visit(this);
+        auto value = getValue(name);
+        if (value == nullptr || !value->isArray()) {
+            return nullptr;
+        }
+        return static_cast<Array*>(value);
     }
 
-    void Null::accept(ValueVisitor* visitor) const
+    std::string Object::getStringValue(StringView name, const std::string& defaultValue) const
     {
-        visitor->visit(this);
+        auto value = getValue(name);
+        if (value == nullptr || !value->isString()) {
+            return defaultValue;
+        }
+        return static_cast<String*>(value)->getValue();
     }
 
-    void Number::accept(ValueVisitor* visitor) const
+    StringView Object::getStringView(StringView name, StringView defaultValue) const
     {
-        visitor->visit(this);
+        auto value = getValue(name);
+        if (value == nullptr || !value->isString()) {
+            return defaultValue;
+        }
+        return static_cast<String*>(value)->getStringView();
     }
 
-    void ValueWriter::visit(const Object* obj)
+    bool Object::getBoolValue(StringView name, bool defaultValue) const
     {
-        auto values = obj->getValues();
-        _str += "{ ";
-        for (const auto& p : values) {
-            _str += ("\"" + p.first + "\"" + " : ");
-            p.second->accept(this);
-            _str += ", ";
+        auto value = getValue(name);
+        if (value == nullptr || !value->isBool()) {
+            return defaultValue;
         }
+        return static_cast<Bool*>(value)->getValue();
+    }
 
-        if (!values.empty()) {
-            _str.pop_back(); // remove space and ,
-            _str.pop_back();
+    void* Object::getNullValue(StringView name) const
+    {
+        auto value = getValue(name);
+        if (value == nullptr || !value->isNull()) {
+            return nullptr;
         }
-        _str += " }";
+        return nullptr;
     }
 
-    void ValueWriter::visit(const Array* obj)
+    double Object::getNumberValue(StringView name, double defaultValue) const
     {
-        auto values = obj->getValues();
-        
-        _str += "[ ";
-        for (const auto& v : values) {
-            v->accept(this);
-            _str += ", ";
+        auto value = getValue(name);
+        if (value == nullptr || !value->isNumber()) {
+            return defaultValue;
         }
+        return static_cast<Number*>(value)->getValue();
+    }
 
-        if (!values.empty()) {
-            _str.pop_back(); // remove space and comma
-            _str.pop_back();
+    std::int64_t Object::getInt64Value(StringView name, std::int64_t defaultValue) const
+    {
+        auto value = getValue(name);
+        if (value == nullptr || !value->isNumber()) {
+            return defaultValue;
         }
+        return static_cast<Number*>(value)->getInt64Value();
+    }
 
-        _str += " ]";
+    std::uint64_t Object::getUint64Value(StringView name, std::uint64_t defaultValue) const
+    {
+        auto value = getValue(name);
+        if (value == nullptr || !value->isNumber()) {
+            return defaultValue;
+        }
+        return static_cast<Number*>(value)->getUint64Value();
     }
 
-    void ValueWriter::visit(const String* obj)
+    String::String(std::string value)
+        : Value(Value::ValueType::STRING), _value(std::move(value)), _inArena(false) {}
+
+    String::String(StringView value, detail::Arena& arena)
+        : Value(Value::ValueType::STRING), _arenaValue(arena.copy(value), value.size()), _inArena(true) {}
+
+    std::string String::getValue() const
     {
-        _str += ("\"" + obj->getValue() + "\"");
+        return _inArena ? _arenaValue.str() : _value;
     }
 
-    void ValueWriter::visit(const Bool* obj)
+    StringView String::getStringView() const
     {
-        auto value = obj->getValue();
-        if (value) {
-            _str += "true";
-        } else {
-            _str += "false";
-        }
+        return _inArena ? _arenaValue : StringView(_value);
     }
 
-    void ValueWriter::visit(const Null* obj)
+    Array::Array()
+        : Array(nullptr) {}
+
+    Array::Array(detail::DocumentResources* document)
+        : Value(Value::ValueType::ARRAY), _resources(document), _attachedTo(document),
+          _values(detail::ArenaAllocator<std::unique_ptr<Value>>(document != nullptr ? document->arena.get() : nullptr)) {}
+
+    Array::~Array()
     {
-        (void)(obj);
-        _str += "null";
+        detail::destroyValues(_values);
     }
 
-    void ValueWriter::visit(const Number* obj)
+    void Array::addValue(std::unique_ptr<Value> value)
     {
-        _str += std::to_string(obj->getValue());
+        if (_attachedTo != nullptr) {
+            ++_attachedTo->generation;
+            detail::attachToDocument(value.get(), _attachedTo);
+        }
+        try {
+            _values.emplace_back(std::move(value));
+        } catch (...) {
+            detail::releaseValue(std::move(value), _values.get_allocator().arena);
+            throw;
+        }
     }
 
-    std::string ValueWriter::getString() const
+    size_t Array::size() const
     {
-        return _str;
+        return _values.size();
     }
 
-    Bool::Bool(bool value)
-        : Value(Value::ValueType::BOOL), _value(value) {}
+    std::vector<Value*> Array::getValues() const
+    {
+        std::vector<Value*> values;
+        values.reserve(size());
+        for (const auto& v : _values) {
+            values.push_back(v.get());
+        }
+        return values;
+    }
 
-    bool Bool::getValue() const
+    Value* Array::getValue(size_t index) const
     {
-        return _value;
+        return _values.at(index).get();
     }
 
-    Null::Null()
-        : Value(Value::ValueType::JNULL) {}
+    Object* Array::getObjectValue(size_t index) const
+    {
+        auto value = getValue(index);
+        if (value == nullptr || !value->isObject()) {
+            return nullptr;
+        }
+        return static_cast<Object*>(value);
+    }
 
-    void* Null::getValue() const
+    Array* Array::getArrayValue(size_t index) const
     {
-        return nullptr;
+        auto value = getValue(index);
+        if (value == nullptr || !value->isArray()) {
+            return nullptr;
+        }
+        return static_cast<Array*>(value);
     }
 
-    Number::Number(double value)
-        : Value(Value::ValueType::NUMBER), _value(value) {}
+    std::string Array::getStringValue(size_t index, const std::string& defaultValue) const
+    {
+        auto value = getValue(index);
+        if (value == nullptr || !value->isString()) {
+            return defaultValue;
+        }
+        return static_cast<String*>(value)->getValue();
+    }
 
-    double Number::getValue() const
+    StringView Array::getStringView(size_t index, StringView defaultValue) const
     {
-        return _value;
+        auto value = getValue(index);
+        if (value == nullptr || !value->isString()) {
+            return defaultValue;
+        }
+        return static_cast<String*>(value)->getStringView();
     }
 
-    namespace detail {
+    bool Array::getBoolValue(size_t index, bool defaultValue) const
+    {
+        auto value = getValue(index);
+        if (value == nullptr || !value->isBool()) {
+            return defaultValue;
+        }
+        return static_cast<Bool*>(value)->getValue();
+    }
 
-        template <class... Args>
-        static std::string format(const char* fmt, Args&&... args)
-        {
-            auto len = std::snprintf(nullptr, 0, fmt, std::forward<Args>(args)...) + 1;
-            std::vector<char> buf(len, '\0');
-            std::snprintf(buf.data(), len, fmt, std::forward<Args>(args)...);
-            return buf.data();
+    double Array::getNumberValue(size_t index, double defaultValue) const
+    { 
+        auto value = getValue(index);
+        if (value == nullptr || !value->isNumber()) {
+            return defaultValue;
         }
+        return static_cast<Number*>(value)->getValue();
+    }
 
-        Token::Token(TokenType type, const std::string& value, int line, int pos)
-            : type(type), value(value), line(line), pos(pos) {}
-        
-        Lexer::Lexer(const std::string& text)
-            : _cursor(0), _text(text), _line(1), _pos(1) {}
+    std::int64_t Array::getInt64Value(size_t index, std::int64_t defaultValue) const
+    {
+        auto value = getValue(index);
+        if (value == nullptr || !value->isNumber()) {
+            return defaultValue;
+        }
+        return static_cast<Number*>(value)->getInt64Value();
+    }
 
-        bool Lexer::isDoneReading() const
-        {
-            return _cursor >= _text.size();
+    std::uint64_t Array::getUint64Value(size_t index, std::uint64_t defaultValue) const
+    {
+        auto value = getValue(index);
+        if (value == nullptr || !value->isNumber()) {
+            return defaultValue;
         }
+        return static_cast<Number*>(value)->getUint64Value();
+    }
 
-        void Lexer::raiseError(const std::string& expected)
-        {
-            throw parse_exception(json::detail::format("Expecting '%s' at line %d:%d but found '%c' instead!", expected.c_str(), _line, _pos, curr()));
+    void* Array::getNullValue(size_t index) const
+    {
+        auto value = getValue(index);
+        if (value == nullptr || !value->isNull()) {
+            return nullptr;
         }
+        return nullptr;
+    }
 
-        Lexer::NumberState Lexer::processState(NumberState state, std::string& value)
-        {
-            char c = curr();
-            if (std::isspace(c)) {
-                state = END;
-            }
+    namespace detail {
 
-            switch (state) {
-            case SIGN:
-                if (std::isdigit(c)) {
-                    value += c;
-                    state = DIGIT;
-                }
-                break;
-            case DIGIT:
-                if (std::isdigit(c)) {
-                    value += c;
-                } else if (c == '.') {
-                    value += c;
-                    state = DECIMAL;
-                } else {
-                    state = END;
+        /**
+         * The text of a file. Regular files are mapped into memory and read straight from the page cache, anything
+         * else, such as a pipe, is read into a buffer. The file must not be truncated while it is mapped.
+         */
+        class FileText {
+        public:
+            FileText(const std::string& filePath) : _mapped(nullptr), _size(0), _open(false)
+            {
+#if defined(_WIN32)
+                std::ifstream file(filePath, std::ios::binary);
+                if (!file.is_open()) {
+                    return;
                 }
-                break;
-            case DECIMAL:
-                if (std::isdigit(c)) {
-                    value += c;
-                } else if (c == 'e' || c == 'E') {
-                    value += c;
-                    state = EXPONENT;
-                } else {
-                    state = END;
+                _open = true;
+                std::ostringstream text;
+                text << file.rdbuf();
+                _buffer = text.str();
+#else
+                int fd;
+                do {
+                    fd = ::open(filePath.c_str(), O_RDONLY);
+                } while (fd < 0 && errno == EINTR);
+                if (fd < 0) {
+                    return;
                 }
-                break;
-            case EXPONENT:
-                if (c == '+' || c == '-') {
-                    value += c;
-                } else if (std::isdigit(c)) {
-                    value += c;
-                    state = EXPONENT_DIGIT;
-                } else {
-                    state = END;
+                _open = true;
+
+                struct stat info;
+                if (::fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+                    void* mapped = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                    if (mapped != MAP_FAILED) {
+                        // the parser reads front to back, so read ahead aggressively and drop pages behind it
+                        ::madvise(mapped, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+                        _mapped = static_cast<char*>(mapped);
+                        _size = static_cast<size_t>(info.st_size);
+                        ::close(fd);
+                        return;
+                    }
                 }
-                break;
-            case EXPONENT_DIGIT:
-                if (std::isdigit(c)) {
-                    value += c;
-                } else {
-                    state = END;
+
+                char chunk[64 * 1024];
+                for (;;) {
+                    const auto count = ::read(fd, chunk, sizeof(chunk));
+                    if (count < 0 && errno == EINTR) {
+                        continue;
+                    }
+                    if (count <= 0) {
+                        if (count < 0) {
+                            _open = false;
+                        }
+                        break;
+                    }
+                    _buffer.append(chunk, static_cast<size_t>(count));
                 }
-                break;
-            default:
-                break;
+                ::close(fd);
+#endif
             }
 
-            if (state != END) {
-                next(); // get the next character ready
+            ~FileText()
+            {
+#if !defined(_WIN32)
+                if (_mapped != nullptr) {
+                    ::munmap(_mapped, _size);
+                }
+#endif
             }
 
-            return state;
-        }
+            FileText(const FileText&) = delete;
+            FileText& operator=(const FileText&) = delete;
 
-        Token Lexer::lexNumber()
-        {
-            const char initialChar = curr();
-            const int initialPosition = _pos; // get the position for reporting
+            bool isOpen() const { return _open; }
+            StringView getText() const { return _mapped != nullptr ? StringView(_mapped, _size) : StringView(_buffer); }
+        private:
+            char* _mapped;
+            size_t _size;
+            std::string _buffer; // used when the file is not mapped
+            bool _open;
+        };
+    }
 
-            std::string value;
-            if (initialChar == '+' || initialChar == '-') {
-                value += initialChar;
-                next(); // eat the sign
-            }
-            
-            NumberState state = DIGIT;
-            while (!isDoneReading() && state != END) {
-                state = processState(state, value);
-            }
-            return { TokenType::NUMBER, value, _line, initialPosition };
+    std::unique_ptr<Object> load(const std::string& filePath)
+    {
+        detail::FileText file(filePath);
+        if (!file.isOpen()) {
+            throw std::runtime_error("Unable to open " + filePath + " to load JSON.");
         }
+        return parse(file.getText());
+    }
 
-        std::string Lexer::lexValueSequence(const std::string& expected)
-        {
-            std::string value;
-            char c = curr();
-            for (size_t i = 0; i < expected.length() && !isDoneReading(); ++i) {
-                if (c != expected[i]) {
-                    raiseError("value sequence " + expected);
-                }
-                value += c;
-                c = next();
-            }
-            return value;
-        }
+    namespace detail {
 
-        Token Lexer::lexBool(const std::string& expected)
-        {
-            const int initialPosition = _pos; // get the position for reporting
-            auto value = lexValueSequence(expected);
-            return { TokenType::JBOOL, value, _line, initialPosition };
-        }
+        // A run of whole lines that one thread parses at a time
+        struct LineBatch {
+            size_t first;
+            size_t last;
+            size_t firstLine;
+            bool done;
+            std::vector<LineResult> results;
+        };
 
-        Token Lexer::lexNull()
+        static void parseBatch(StringView text, LineBatch& batch, const ParseOptions& options)
         {
-            const int initialPosition = _pos; // get the position for reporting
-            auto value = lexValueSequence("null");
-            return { TokenType::JNULL, value, _line, initialPosition };
-        }
+            size_t line = batch.firstLine;
+            for (size_t begin = batch.first; begin < batch.last; ++line) {
+                const char* newline = static_cast<const char*>(std::memchr(text.data() + begin, '\n', batch.last - begin));
+                const size_t end = newline != nullptr ? newline - text.data() : batch.last;
+                const StringView record(text.data() + begin, end - begin);
+                begin = end + 1;
 
-        bool Lexer::isWhitespaceControlChar(char n) const
-        {
-            return n == 'b' || n == 'f' || n == 'n' || n == 'r' || n == 't';
+                if (std::all_of(record.begin(), record.end(), [](char c) { return std::isspace(static_cast<unsigned char>(c)) != 0; })) {
+                    continue;
+                }
+
+                // malformed lines are common enough in logs that they are not worth an exception each
+                LineResult result;
+                result.line = line;
+                auto parsed = tryParse(record, options);
+                result.object = std::move(parsed.object);
+                if (result.object == nullptr) {
+                    result.error = parsed.getMessage();
+                }
+                batch.results.push_back(std::move(result));
+            }
         }
 
-        bool Lexer::isControlChar(char c) const
+        static std::vector<LineBatch> splitLines(StringView text, size_t batchSize)
         {
-            return c == '\"' || c == '\\' || c == '/' || isWhitespaceControlChar(c) || c == 'u';
+            std::vector<LineBatch> batches;
+            size_t line = 1;
+            for (size_t first = 0; first < text.size();) {
+                // end the batch on a line boundary
+                size_t last = std::min(text.size(), first + std::max<size_t>(batchSize, 1));
+                if (last < text.size()) {
+                    auto newline = static_cast<const char*>(std::memchr(text.data() + last, '\n', text.size() - last));
+                    last = newline != nullptr ? newline - text.data() + 1 : text.size();
+                }
+                batches.push_back({ first, last, line, false, {} });
+                line += std::count(text.data() + first, text.data() + last, '\n');
+                first = last;
+            }
+            return batches;
         }
+    }
 
-        char Lexer::getControlChar()
-        {
-            char n = peek();
-            if (n == EOF) {
-                throw parse_exception(json::detail::format("Dangling control '\\' found at line %d:%d!", _line, _pos));
+    void parseLines(StringView text, const std::function<void(LineResult&)>& callback, const LineOptions& options)
+    {
+        auto batches = detail::splitLines(text, options.batchSize);
+        const size_t threads = std::min<size_t>(batches.size(), options.threads != 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency()));
+
+        auto deliver = [&](detail::LineBatch& batch) {
+            for (auto& result : batch.results) {
+                callback(result);
             }
-            next(); // eat the control character
+            batch.results = std::vector<LineResult>();
+        };
 
-            if (isControlChar(n)) {
-                return n;
-            } else {
-                raiseError(R"(("|\|/|b|f|n|r|t) control character)");
+        if (threads <= 1) {
+            for (auto& batch : batches) {
+                detail::parseBatch(text, batch, options.parseOptions);
+                deliver(batch);
             }
-            return EOF;
+            return;
         }
 
-        bool Lexer::isHexChar(char c)
-        {
-            const auto lower = std::tolower(c);
-            return std::isdigit(c) || (lower >= 'a' && lower <= 'f');
-        }
+        // the workers stay at most this many batches ahead of the delivered ones to bound the memory held by results
+        const size_t window = threads * 4;
 
-        std::string Lexer::getHexDigits()
-        {
-            std::string digits;
-            for (char c = curr(); !isDoneReading(); c = next()) {
-                if (isHexChar(c)) {
-                    digits += c;
-                } else {
-                    --_cursor; // leave the lexer at the last valid character
-                    break;
+        std::mutex mutex;
+        std::condition_variable changed;
+        size_t nextBatch = 0;
+        size_t delivered = 0;
+        bool stop = false;
+        std::queue<size_t> completed; // in the order the workers finished them
+        std::exception_ptr failure; // of the first batch that could not be parsed, rethrown once the workers are joined
+
+        auto work = [&]() {
+            for (;;) {
+                size_t index;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    changed.wait(lock, [&] { return stop || nextBatch == batches.size() || nextBatch < delivered + window; });
+                    if (stop || nextBatch == batches.size()) {
+                        return;
+                    }
+                    index = nextBatch++;
                 }
+
+                try {
+                    detail::parseBatch(text, batches[index], options.parseOptions);
+                } catch (...) {
+                    // e.g. running out of memory, which must not escape the thread
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if (failure == nullptr) {
+                            failure = std::current_exception();
+                        }
+                        stop = true;
+                    }
+                    changed.notify_all();
+                    return;
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    batches[index].done = true;
+                    completed.push(index);
+                }
+                changed.notify_all();
             }
-            
-            if (digits.length() != 4) {
-                throw parse_exception(json::detail::format("Only 4 hexadecimal values accepted at line %d:%d", _line, _pos));
-            }
+        };
 
-            return digits;
-        }
+        std::vector<std::thread> workers;
+        auto join = [&]() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stop = true;
+            }
+            changed.notify_all();
+            for (auto& worker : workers) {
+                worker.join();
+            }
+        };
 
-        Token Lexer::lexString()
-        {
-            if (curr() != '\"') {
-                raiseError("initial \" for string");
+        try {
+            for (size_t i = 0; i < threads; ++i) {
+                workers.emplace_back(work);
             }
-            const int initialPosition = _pos; // get the position for reporting
-            next(); // eat the quote
 
-            std::string str;
-            bool endQuoteFound = false;
-            for (char c = curr(); !endQuoteFound && !isDoneReading(); c = next()) {
-                if (c == '\"') {
-                    endQuoteFound = true;
-                } else if (c == '\\') {
-                    char n = getControlChar();
-                    if (isWhitespaceControlChar(n)) {
-                        str += c;
-                        str += n;
-                    } else if (n == 'u') {
-                        next(); // eat the 'u'
-                        str += getHexDigits();
+            while (delivered < batches.size()) {
+                size_t index;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    if (options.ordered) {
+                        index = delivered;
+                        changed.wait(lock, [&] { return batches[index].done || failure != nullptr; });
                     } else {
-                        str += n;
+                        changed.wait(lock, [&] { return !completed.empty() || failure != nullptr; });
+                        index = !completed.empty() ? completed.front() : 0;
+                    }
+                    if (failure != nullptr) {
+                        break;
+                    }
+                    if (!options.ordered) {
+                        completed.pop();
                     }
-                } else {
-                    str += c;
                 }
-            }
 
-            if (!endQuoteFound) {
-                raiseError("Terminating \" for string");
+                deliver(batches[index]);
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    ++delivered;
+                }
+                changed.notify_all();
             }
-            return {TokenType::STRING, str, _line, initialPosition };
+        } catch (...) {
+            join();
+            throw;
         }
+        join();
+        if (failure != nullptr) {
+            std::rethrow_exception(failure);
+        }
+    }
 
-        char Lexer::next()
-        {
-            ++_pos;
-            return _text[++_cursor];
+    void loadLines(const std::string& filePath, const std::function<void(LineResult&)>& callback, const LineOptions& options)
+    {
+        detail::FileText file(filePath);
+        if (!file.isOpen()) {
+            throw std::runtime_error("Unable to open " + filePath + " to load JSON lines.");
         }
+        parseLines(file.getText(), callback, options);
+    }
 
-        char Lexer::curr()
-        {
-            return _text[_cursor];
+    void write(const Object* obj, const std::string& filePath)
+    {
+        std::ofstream file(filePath);
+        if (!file.is_open()) {
+            throw std::runtime_error("Unable to open " + filePath + " to write JSON.");
         }
+        write(obj, file);
+    }
 
-        char Lexer::peek()
+    void write(const Object* obj, std::ostream& stream)
+    {
+        StreamWriter writer(stream);
+        obj->accept(&writer);
+        writer.flush();
+    }
+
+    namespace detail {
+
+        // Returns null and fills in the failure when the text is malformed
+        static std::unique_ptr<Object> parseObject(StringView text, const ParseOptions& options, ParseFailure& failure)
         {
-            if (_cursor + 1 >= _text.size()) {
-                return EOF;
+            std::unique_ptr<DocumentResources> resources;
+            if (options.arena || options.keys != nullptr || options.shapes != nullptr || options.keyIndex) {
+                resources = std::make_unique<DocumentResources>();
+                resources->keys = options.shapes != nullptr ? options.shapes->getKeys() : options.keys;
+                resources->shapes = options.shapes;
+                resources->indexKeys = options.keyIndex;
             }
-            return _text[_cursor + 1];
+            if (options.arena) {
+                // the DOM usually takes more memory than its text so start with a chunk the size of the text
+                resources->arena = std::make_unique<Arena>(std::max<size_t>(4096, text.size()));
+            }
+
+            // the index stores 32 bit offsets so larger texts are lexed byte by byte
+            std::unique_ptr<StructuralIndex> index;
+            if (options.structuralIndex && text.size() <= std::numeric_limits<std::uint32_t>::max()) {
+                index = std::make_unique<StructuralIndex>(text);
+            }
+            Parser parser(Lexer(text, index.get()), std::move(resources), options.maxDepth);
+            auto obj = parser.parse();
+            if (obj == nullptr) {
+                failure = parser.getFailure();
+            }
+            return obj;
         }
 
-        void Lexer::skipWhitespace()
+        static bool parseEvents(StringView text, ParseHandler* handler, const ParseOptions& options, ParseFailure& failure)
         {
-            for (char c = curr(); !isDoneReading() && std::isspace(c); c = next()) {
-                if (c == '\n') {
-                    ++_line;
-                    _pos = 0;
-                }
+            std::unique_ptr<StructuralIndex> index;
+            if (options.structuralIndex && text.size() <= std::numeric_limits<std::uint32_t>::max()) {
+                index = std::make_unique<StructuralIndex>(text);
+            }
+            EventParser parser(Lexer(text, index.get()), handler, options.maxDepth);
+            if (!parser.parse()) {
+                failure = parser.getFailure();
+                return false;
             }
+            return true;
         }
+    }
 
-        Token Lexer::reportToken(TokenType type, const std::string& str)
-        {
-            const int currentPosition = _pos;
-            next(); // eat the token
-            return { type, str, _line, currentPosition };
+    std::unique_ptr<Object> parse(StringView text)
+    {
+        detail::Lexer lexer(text);
+        detail::Parser parser(lexer);
+        auto obj = parser.parse();
+        if (obj == nullptr) {
+            throw parse_exception(parser.getFailure().getMessage(text));
         }
+        return obj;
+    }
 
-        Token Lexer::getToken() 
-        {
-            skipWhitespace();
-            if (isDoneReading()) {
-                return { TokenType::NONE, "" };
-            }
+    std::unique_ptr<Object> parse(StringView text, const ParseOptions& options)
+    {
+        detail::ParseFailure failure;
+        auto obj = detail::parseObject(text, options, failure);
+        if (obj == nullptr) {
+            throw parse_exception(failure.getMessage(text));
+        }
+        return obj;
+    }
 
-            char c = curr();
-            if (c == '{') {
-                return reportToken(TokenType::LBRACE, "{");
-            } else if (c == '}') {
-                return reportToken(TokenType::RBRACE, "}");
-            } else if (c == '\"') {
-                return lexString();
-            } else if (c == ':') {
-                return reportToken(TokenType::COLON, ":");
-            } else if (c == ',') {
-                return reportToken(TokenType::COMMA, ",");
-            } else if (c == '[') {
-                return reportToken(TokenType::LBRACKET, "[");
-            } else if (c == ']') {
-                return reportToken(TokenType::RBRACKET, "{");
-            } else if (c == 't') {
-                return lexBool("true");
-            } else if (c == 'f') {
-                return lexBool("false");
-            } else if (c == 'n') {
-                return lexNull();
-            } else if (c == '-' || c == '+' || std::isdigit(c)) {
-                return lexNumber();
-            } else {
-                throw parse_exception(c + " is not a valid token!");
-            }
+    std::string ParseResult::getMessage() const
+    {
+        return _failure.getMessage(_text);
+    }
+
+    ParseResult tryParse(StringView text, const ParseOptions& options) noexcept
+    {
+        ParseResult result;
+        result._text = text;
+        try {
+            result.object = detail::parseObject(text, options, result._failure);
+        } catch (const std::bad_alloc&) {
+            result._failure.code = ParseErrorCode::OUT_OF_MEMORY;
+        } catch (const std::length_error&) {
+            result._failure.code = ParseErrorCode::TOO_LARGE;
+        } catch (...) {
+            // e.g. a std::system_error from the locks of a shared key or shape table
+            result._failure.code = ParseErrorCode::INTERNAL_ERROR;
         }
+        result.error = result._failure.code;
+        result.offset = result._failure.offset;
+        return result;
+    }
 
-        void Parser::raiseError(const std::string& expected)
-        {
-            throw parse_exception(json::detail::format("Expecting '%s' at line %d:%d but got '%s' instead!", expected.c_str(), currentToken.line, currentToken.pos, currentToken.value.c_str()));
+    void parse(StringView text, ParseHandler* handler)
+    {
+        detail::Lexer lexer(text);
+        detail::EventParser parser(lexer, handler);
+        if (!parser.parse()) {
+            throw parse_exception(parser.getFailure().getMessage(text));
         }
+    }
 
-        std::unique_ptr<Object> Parser::parseObject()
-        {
-            currentToken = lexer.getToken();
+    void parse(StringView text, ParseHandler* handler, const ParseOptions& options)
+    {
+        detail::ParseFailure failure;
+        if (!detail::parseEvents(text, handler, options, failure)) {
+            throw parse_exception(failure.getMessage(text));
+        }
+    }
 
-            // an empty object
-            if (currentToken.type == detail::TokenType::RBRACE) {
-                return std::make_unique<Object>();
-            }
+    void Object::accept(ValueVisitor* visitor) const
+    {
+        visitor->visit(this);
+    }
+
+    void Array::accept(ValueVisitor* visitor) const
+    {
+        visitor->visit(this);
+    }
+
+    void String::accept(ValueVisitor* visitor) const
+    {
+        visitor->visit(this);
+    }
+
+    void Bool::accept(ValueVisitor* visitor) const
+    {
+        visitor->visit(this);
+    }
+
+    void Null::accept(ValueVisitor* visitor) const
+    {
+        visitor->visit(this);
+    }
+
+    void Number::accept(ValueVisitor* visitor) const
+    {
+        visitor->visit(this);
+    }
 
-            auto obj = parseValueList();
+    namespace detail {
+
+        struct ReclaimQueue {
+            std::mutex mutex;
+            std::condition_variable changed;
+            std::queue<std::unique_ptr<Value>> values;
+            size_t handedOver = 0;
+            size_t destroyed = 0;
+            bool stop = false;
+            std::thread thread;
+
+            void run()
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                for (;;) {
+                    changed.wait(lock, [this] { return stop || !values.empty(); });
+                    if (values.empty()) {
+                        return;
+                    }
+                    auto value = std::move(values.front());
+                    values.pop();
 
-            // closing brace
-            if (currentToken.type != detail::TokenType::RBRACE) {
-                raiseError("}");
+                    lock.unlock();
+                    value.reset();
+                    lock.lock();
+
+                    ++destroyed;
+                    changed.notify_all();
+                }
             }
+        };
+    }
 
-            return obj;
+    Reclaimer::Reclaimer()
+        : _queue(new detail::ReclaimQueue())
+    {
+        auto queue = _queue.get();
+        queue->thread = std::thread([queue] { queue->run(); });
+    }
+
+    Reclaimer::~Reclaimer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_queue->mutex);
+            _queue->stop = true;
+        }
+        _queue->changed.notify_all();
+        _queue->thread.join();
+    }
+
+    void Reclaimer::reclaim(std::unique_ptr<Value> value)
+    {
+        if (value == nullptr) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(_queue->mutex);
+            _queue->values.push(std::move(value));
+            ++_queue->handedOver;
         }
+        _queue->changed.notify_all();
+    }
+
+    void Reclaimer::wait()
+    {
+        std::unique_lock<std::mutex> lock(_queue->mutex);
+        const size_t target = _queue->handedOver;
+        _queue->changed.wait(lock, [&] { return _queue->destroyed >= target; });
+    }
+
+    void reclaimLater(std::unique_ptr<Value> value)
+    {
+        static Reclaimer reclaimer;
+        reclaimer.reclaim(std::move(value));
+    }
+
+    namespace detail {
 
-        std::unique_ptr<Array> Parser::parseArray()
+        static const char DIGIT_PAIRS[] =
+            "00010203040506070809"
+            "10111213141516171819"
+            "20212223242526272829"
+            "30313233343536373839"
+            "40414243444546474849"
+            "50515253545556575859"
+            "60616263646566676869"
+            "70717273747576777879"
+            "80818283848586878889"
+            "90919293949596979899";
+
+        // Formats the digits back to front two at a time, ending at end, and returns where they start
+        static char* formatInteger(char* end, std::uint64_t value)
         {
-            currentToken = lexer.getToken();
-            // empty array
-            if (currentToken.type == TokenType::RBRACKET) {
-                return std::make_unique<Array>();
+            char* it = end;
+            while (value >= 100) {
+                const auto pair = static_cast<size_t>(value % 100) * 2;
+                value /= 100;
+                *--it = DIGIT_PAIRS[pair + 1];
+                *--it = DIGIT_PAIRS[pair];
+            }
+            if (value >= 10) {
+                const auto pair = static_cast<size_t>(value) * 2;
+                *--it = DIGIT_PAIRS[pair + 1];
+                *--it = DIGIT_PAIRS[pair];
+            } else {
+                *--it = static_cast<char>('0' + value);
             }
+            return it;
+        }
 
-            auto arr = std::make_unique<Array>();
-            bool isList = false;
-            do {
-                arr->addValue(parseValue());
+        /**
+         * Shortest round trip formatting of doubles with Grisu2 (Florian Loitsch, "Printing Floating-Point Numbers
+         * Quickly and Accurately with Integers"). The digits always read back as the same double and are the shortest
+         * such digits for all but a tiny fraction of values, without any locale or snprintf involvement.
+         */
+        struct DiyFp {
+            std::uint64_t f;
+            int e;
 
-                currentToken = lexer.getToken();
-                if (currentToken.type == TokenType::COMMA) {
-                    isList = true;
-                    currentToken = lexer.getToken(); // eat the comma
+            DiyFp(std::uint64_t f, int e) : f(f), e(e) {}
+
+            explicit DiyFp(double value)
+            {
+                std::uint64_t bits;
+                std::memcpy(&bits, &value, sizeof(bits));
+                const int biased = static_cast<int>((bits >> 52) & 0x7FF);
+                const std::uint64_t significand = bits & ((std::uint64_t(1) << 52) - 1);
+                if (biased != 0) {
+                    f = significand | (std::uint64_t(1) << 52);
+                    e = biased - 1075;
                 } else {
-                    isList = false;
+                    f = significand;
+                    e = -1074;
+                }
+            }
+
+            DiyFp operator-(const DiyFp& rhs) const
+            {
+                return DiyFp(f - rhs.f, e);
+            }
+
+            // The upper 64 bits of the product, rounded
+            DiyFp operator*(const DiyFp& rhs) const
+            {
+                const std::uint64_t M32 = 0xFFFFFFFF;
+                const std::uint64_t a = f >> 32, b = f & M32, c = rhs.f >> 32, d = rhs.f & M32;
+                const std::uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+                std::uint64_t tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+                tmp += std::uint64_t(1) << 31;
+                return DiyFp(ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), e + rhs.e + 64);
+            }
+
+            DiyFp normalize() const
+            {
+                DiyFp result = *this;
+                while ((result.f & (std::uint64_t(1) << 63)) == 0) {
+                    result.f <<= 1;
+                    result.e--;
                 }
-            } while (isList);
+                return result;
+            }
 
-            if (currentToken.type != TokenType::RBRACKET) {
-                raiseError("]");
+            // The halfway points to the neighbouring doubles, scaled to the same exponent
+            void boundaries(DiyFp& minus, DiyFp& plus) const
+            {
+                plus = DiyFp((f << 1) + 1, e - 1).normalize();
+                // the gap below a power of two is half as wide
+                minus = f == (std::uint64_t(1) << 52) ? DiyFp((f << 2) - 1, e - 2) : DiyFp((f << 1) - 1, e - 1);
+                minus.f <<= minus.e - plus.e;
+                minus.e = plus.e;
             }
+        };
+
+        // 10^k for k = -348, -340, ..., 340 as normalized 64 bit significands and binary exponents
+        static const std::uint64_t CACHED_POWERS_F[] = {
+            0xfa8fd5a0081c0288, 0xbaaee17fa23ebf76, 0x8b16fb203055ac76, 0xcf42894a5dce35ea,
+            0x9a6bb0aa55653b2d, 0xe61acf033d1a45df, 0xab70fe17c79ac6ca, 0xff77b1fcbebcdc4f,
+            0xbe5691ef416bd60c, 0x8dd01fad907ffc3c, 0xd3515c2831559a83, 0x9d71ac8fada6c9b5,
+            0xea9c227723ee8bcb, 0xaecc49914078536d, 0x823c12795db6ce57, 0xc21094364dfb5637,
+            0x9096ea6f3848984f, 0xd77485cb25823ac7, 0xa086cfcd97bf97f4, 0xef340a98172aace5,
+            0xb23867fb2a35b28e, 0x84c8d4dfd2c63f3b, 0xc5dd44271ad3cdba, 0x936b9fcebb25c996,
+            0xdbac6c247d62a584, 0xa3ab66580d5fdaf6, 0xf3e2f893dec3f126, 0xb5b5ada8aaff80b8,
+            0x87625f056c7c4a8b, 0xc9bcff6034c13053, 0x964e858c91ba2655, 0xdff9772470297ebd,
+            0xa6dfbd9fb8e5b88f, 0xf8a95fcf88747d94, 0xb94470938fa89bcf, 0x8a08f0f8bf0f156b,
+            0xcdb02555653131b6, 0x993fe2c6d07b7fac, 0xe45c10c42a2b3b06, 0xaa242499697392d3,
+            0xfd87b5f28300ca0e, 0xbce5086492111aeb, 0x8cbccc096f5088cc, 0xd1b71758e219652c,
+            0x9c40000000000000, 0xe8d4a51000000000, 0xad78ebc5ac620000, 0x813f3978f8940984,
+            0xc097ce7bc90715b3, 0x8f7e32ce7bea5c70, 0xd5d238a4abe98068, 0x9f4f2726179a2245,
+            0xed63a231d4c4fb27, 0xb0de65388cc8ada8, 0x83c7088e1aab65db, 0xc45d1df942711d9a,
+            0x924d692ca61be758, 0xda01ee641a708dea, 0xa26da3999aef774a, 0xf209787bb47d6b85,
+            0xb454e4a179dd1877, 0x865b86925b9bc5c2, 0xc83553c5c8965d3d, 0x952ab45cfa97a0b3,
+            0xde469fbd99a05fe3, 0xa59bc234db398c25, 0xf6c69a72a3989f5c, 0xb7dcbf5354e9bece,
+            0x88fcf317f22241e2, 0xcc20ce9bd35c78a5, 0x98165af37b2153df, 0xe2a0b5dc971f303a,
+            0xa8d9d1535ce3b396, 0xfb9b7cd9a4a7443c, 0xbb764c4ca7a44410, 0x8bab8eefb6409c1a,
+            0xd01fef10a657842c, 0x9b10a4e5e9913129, 0xe7109bfba19c0c9d, 0xac2820d9623bf429,
+            0x80444b5e7aa7cf85, 0xbf21e44003acdd2d, 0x8e679c2f5e44ff8f, 0xd433179d9c8cb841,
+            0x9e19db92b4e31ba9, 0xeb96bf6ebadf77d9, 0xaf87023b9bf0ee6b
+        };
+        static const std::int16_t CACHED_POWERS_E[] = {
+            -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927,
+            -901, -874, -847, -821, -794, -768, -741, -715, -688, -661, -635, -608,
+            -582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316, -289,
+            -263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30,
+            56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+            375, 402, 428, 455, 481, 508, 534, 561, 588, 614, 641, 667,
+            694, 720, 747, 774, 800, 827, 853, 880, 907, 933, 960, 986,
+            1013, 1039, 1066
+        };
 
-            return arr;
+        static const std::uint32_t POWERS_OF_TEN_32[] = {
+            1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+        };
+
+        // A cached power of ten that brings a number with the binary exponent e into [2^-60, 2^-32), and its exponent
+        static DiyFp cachedPower(int e, int& k)
+        {
+            const double dk = (-61 - e) * 0.30102999566398114 + 347;
+            int rounded = static_cast<int>(dk);
+            if (dk - rounded > 0.0) {
+                rounded++;
+            }
+            const size_t index = static_cast<size_t>((rounded >> 3) + 1);
+            k = -(-348 + static_cast<int>(index << 3));
+            return DiyFp(CACHED_POWERS_F[index], CACHED_POWERS_E[index]);
         }
 
-        std::unique_ptr<Value> Parser::parseValue()
+        // Moves the last digit towards the exact value for as long as the digits stay within the boundaries
+        static void grisuRound(char* digits, int length, std::uint64_t delta, std::uint64_t rest, std::uint64_t tenKappa, std::uint64_t distance)
         {
-            if (currentToken.type == detail::TokenType::STRING) {
-                return std::make_unique<json::String>(currentToken.value);
-            } else if (currentToken.type == detail::TokenType::LBRACKET) {
-                return parseArray();
-            } else if (currentToken.type == detail::TokenType::JBOOL) {
-                return std::make_unique<json::Bool>(currentToken.value == "true");
-            } else if (currentToken.type == detail::TokenType::JNULL) {
-                return std::make_unique<json::Null>();
-            } else if (currentToken.type == detail::TokenType::NUMBER) {
-                return std::make_unique<json::Number>(std::stod(currentToken.value));
-            } else if (currentToken.type == detail::TokenType::LBRACE) {
-                return parseObject();
-            } else {
-                raiseError("<value>");
+            while (rest < distance && delta - rest >= tenKappa
+                && (rest + tenKappa < distance || distance - rest > rest + tenKappa - distance)) {
+                digits[length - 1]--;
+                rest += tenKappa;
             }
-            return nullptr;
         }
 
-        std::unique_ptr<json::Object> Parser::parseValueList()
+        static void generateDigits(const DiyFp& w, const DiyFp& plus, std::uint64_t delta, char* digits, int& length, int& k)
         {
-            auto obj = std::make_unique<Object>();
-            bool isList = false;
-            do {
-                // name
-                if (currentToken.type != detail::TokenType::STRING) {
-                    raiseError("<string>");
-                }
-                auto name = currentToken.value;
+            const DiyFp one(std::uint64_t(1) << -plus.e, plus.e);
+            const DiyFp distance = plus - w;
+            std::uint32_t integral = static_cast<std::uint32_t>(plus.f >> -one.e);
+            std::uint64_t fraction = plus.f & (one.f - 1);
+
+            int kappa = 1;
+            while (kappa < 10 && integral >= POWERS_OF_TEN_32[kappa]) {
+                kappa++;
+            }
 
-                // colon
-                currentToken = lexer.getToken();
-                if (currentToken.type != detail::TokenType::COLON) {
-                    raiseError(":");
+            length = 0;
+            while (kappa > 0) {
+                const std::uint32_t digit = integral / POWERS_OF_TEN_32[kappa - 1];
+                integral %= POWERS_OF_TEN_32[kappa - 1];
+                if (digit != 0 || length != 0) {
+                    digits[length++] = static_cast<char>('0' + digit);
+                }
+                kappa--;
+                const std::uint64_t rest = (static_cast<std::uint64_t>(integral) << -one.e) + fraction;
+                if (rest <= delta) {
+                    k += kappa;
+                    grisuRound(digits, length, delta, rest, static_cast<std::uint64_t>(POWERS_OF_TEN_32[kappa]) << -one.e, distance.f);
+                    return;
                 }
-                currentToken = lexer.getToken(); // eat the colon
+            }
 
-                // value
-                auto value = parseValue();
-                obj->addValue(name, std::move(value));
-
-                // if there is a comma, we continue parsing the list
-                // otherwise, we are at the end of the name/value pairs
-                currentToken = lexer.getToken();
-                if (currentToken.type == detail::TokenType::COMMA) {
-                    isList = true;
-                    currentToken = lexer.getToken(); // eat the comma
-                } else {
-                    isList = false;
+            for (;;) {
+                fraction *= 10;
+                delta *= 10;
+                const char digit = static_cast<char>(fraction >> -one.e);
+                if (digit != 0 || length != 0) {
+                    digits[length++] = static_cast<char>('0' + digit);
+                }
+                fraction &= one.f - 1;
+                kappa--;
+                if (fraction < delta) {
+                    k += kappa;
+                    const int index = -kappa;
+                    grisuRound(digits, length, delta, fraction, one.f, distance.f * (index < 10 ? POWERS_OF_TEN_32[index] : 0));
+                    return;
                 }
+            }
+        }
 
-            } while (isList);
-            return obj;
+        // The shortest digits of a positive finite double, whose value is digits * 10^k
+        static void grisu2(double value, char* digits, int& length, int& k)
+        {
+            const DiyFp v(value);
+            DiyFp minus(0, 0), plus(0, 0);
+            v.boundaries(minus, plus);
+
+            const DiyFp power = cachedPower(plus.e, k);
+            const DiyFp w = v.normalize() * power;
+            DiyFp upper = plus * power;
+            DiyFp lower = minus * power;
+            // stay inside the boundaries despite the rounding of the multiplications
+            lower.f++;
+            upper.f--;
+            generateDigits(w, upper, upper.f - lower.f, digits, length, k);
         }
 
-        std::unique_ptr<Object> Parser::parse()
+        static char* formatExponent(int exponent, char* out)
         {
-            currentToken = lexer.getToken();
-            if (currentToken.type != detail::TokenType::LBRACE) {
-                raiseError("{");
+            if (exponent < 0) {
+                *out++ = '-';
+                exponent = -exponent;
             }
-            return parseObject();
+            char buffer[4];
+            char* end = buffer + sizeof(buffer);
+            char* first = formatInteger(end, static_cast<std::uint64_t>(exponent));
+            std::memcpy(out, first, end - first);
+            return out + (end - first);
         }
 
-        Parser::Parser(Lexer lexer)
-            : lexer(lexer) {}
+        // Places the decimal point like JavaScript does: plain notation from 1e-6 up to 1e21, exponents otherwise
+        static char* formatDigits(char* digits, int length, int k)
+        {
+            const int point = length + k; // 10^(point - 1) <= value < 10^point
+            if (k >= 0 && point <= 21) {
+                // 1234e7 -> 12340000000.0
+                for (int i = length; i < point; i++) {
+                    digits[i] = '0';
+                }
+                digits[point] = '.';
+                digits[point + 1] = '0';
+                return digits + point + 2;
+            } else if (point > 0 && point <= 21) {
+                // 1234e-2 -> 12.34
+                std::memmove(digits + point + 1, digits + point, length - point);
+                digits[point] = '.';
+                return digits + length + 1;
+            } else if (point > -6 && point <= 0) {
+                // 1234e-6 -> 0.001234
+                const int offset = 2 - point;
+                std::memmove(digits + offset, digits, length);
+                digits[0] = '0';
+                digits[1] = '.';
+                for (int i = 2; i < offset; i++) {
+                    digits[i] = '0';
+                }
+                return digits + length + offset;
+            } else if (length == 1) {
+                // 1e30
+                digits[1] = 'e';
+                return formatExponent(point - 1, digits + 2);
+            }
+            // 1234e30 -> 1.234e33
+            std::memmove(digits + 2, digits + 1, length - 1);
+            digits[1] = '.';
+            digits[length + 1] = 'e';
+            return formatExponent(point - 1, digits + length + 2);
+        }
+
+        /**
+         * Formats a double with the fewest digits that read back as the same double into at least 32 characters and
+         * returns the end of the text. Doubles always get a fraction or an exponent, so they read back as doubles, and
+         * NaN and the infinities, which JSON cannot express, are written as null.
+         */
+        static char* formatDouble(double value, char* out)
+        {
+            if (value != value || value - value != 0.0) {
+                std::memcpy(out, "null", 4);
+                return out + 4;
+            }
+            if (std::signbit(value)) {
+                *out++ = '-';
+                value = -value;
+            }
+            if (value == 0.0) {
+                std::memcpy(out, "0.0", 3);
+                return out + 3;
+            }
+
+            // integral values below 2^53 are exact integers so their digits are already the shortest
+            if (value < 9007199254740992.0 && value == static_cast<double>(static_cast<std::uint64_t>(value))) {
+                char buffer[20];
+                char* end = buffer + sizeof(buffer);
+                char* first = formatInteger(end, static_cast<std::uint64_t>(value));
+                std::memcpy(out, first, end - first);
+                out += end - first;
+                std::memcpy(out, ".0", 2);
+                return out + 2;
+            }
+
+            int length = 0;
+            int k = 0;
+            grisu2(value, out, length, k);
+            return formatDigits(out, length, k);
+        }
+
+        // Defined with the lexer, which looks for the same characters
+        static const char* findStringSpecial(const char* first, const char* last);
+
+        static void writeToDescriptor(int fileDescriptor, const char* data, size_t size)
+        {
+            while (size != 0) {
+#if defined(_WIN32)
+                const int chunk = size > INT_MAX ? INT_MAX : static_cast<int>(size);
+                const auto written = ::_write(fileDescriptor, data, chunk);
+#else
+                const auto written = ::write(fileDescriptor, data, size);
+#endif
+                if (written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw std::runtime_error("Unable to write JSON to file descriptor " + std::to_string(fileDescriptor) + ".");
+                }
+                data += written;
+                size -= static_cast<size_t>(written);
+            }
+        }
+    }
+
+    const size_t StreamWriter::DEFAULT_BUFFER_SIZE = 64 * 1024;
+
+    StreamWriter::StreamWriter(std::function<void(const char* data, size_t size)> sink, size_t bufferSize)
+        : _sink(std::move(sink)), _buffer(std::max<size_t>(bufferSize, 64)), _size(0) {}
+
+    StreamWriter::StreamWriter(std::ostream& stream, size_t bufferSize)
+        : StreamWriter([&stream](const char* data, size_t size) {
+            stream.write(data, static_cast<std::streamsize>(size));
+            if (!stream) {
+                throw std::runtime_error("Unable to write JSON to the stream.");
+            }
+        }, bufferSize) {}
+
+    StreamWriter::StreamWriter(int fileDescriptor, size_t bufferSize)
+        : StreamWriter([fileDescriptor](const char* data, size_t size) {
+            detail::writeToDescriptor(fileDescriptor, data, size);
+        }, bufferSize) {}
+
+    void StreamWriter::flush()
+    {
+        if (_size != 0) {
+            const auto size = _size;
+            _size = 0;
+            _sink(_buffer.data(), size);
+        }
+    }
+
+    void StreamWriter::put(char c)
+    {
+        if (_size == _buffer.size()) {
+            flush();
+        }
+        _buffer[_size++] = c;
+    }
+
+    void StreamWriter::put(const char* data, size_t size)
+    {
+        while (size != 0) {
+            if (_size == _buffer.size()) {
+                flush();
+            }
+            const size_t chunk = std::min(size, _buffer.size() - _size);
+            std::memcpy(_buffer.data() + _size, data, chunk);
+            _size += chunk;
+            data += chunk;
+            size -= chunk;
+        }
+    }
+
+    void StreamWriter::putString(StringView str)
+    {
+        static const char HEX_DIGITS[] = "0123456789abcdef";
+
+        put('"');
+        const char* first = str.begin();
+        const char* last = str.end();
+        for (;;) {
+            // copy everything up to the next character that needs escaping in one go
+            const char* special = detail::findStringSpecial(first, last);
+            put(first, special - first);
+            if (special == last) {
+                break;
+            }
+
+            const char c = *special;
+            switch (c) {
+            case '"': put("\\\"", 2); break;
+            case '\\': put("\\\\", 2); break;
+            case '\b': put("\\b", 2); break;
+            case '\f': put("\\f", 2); break;
+            case '\n': put("\\n", 2); break;
+            case '\r': put("\\r", 2); break;
+            case '\t': put("\\t", 2); break;
+            default: {
+                const char escape[] = { '\\', 'u', '0', '0', HEX_DIGITS[(c >> 4) & 0xF], HEX_DIGITS[c & 0xF] };
+                put(escape, sizeof(escape));
+            }
+            }
+            first = special + 1;
+        }
+        put('"');
+    }
+
+    void StreamWriter::visit(const Object* obj)
+    {
+        put("{ ", 2);
+        bool first = true;
+        for (auto member : *obj) {
+            if (!first) {
+                put(", ", 2);
+            }
+            first = false;
+            putString(member.name);
+            put(" : ", 3);
+            member.value->accept(this);
+        }
+        put(" }", 2);
+    }
+
+    void StreamWriter::visit(const Array* obj)
+    {
+        put("[ ", 2);
+        bool first = true;
+        for (auto value : *obj) {
+            if (!first) {
+                put(", ", 2);
+            }
+            first = false;
+            value->accept(this);
+        }
+        put(" ]", 2);
+    }
+
+    void StreamWriter::visit(const String* obj)
+    {
+        putString(obj->getStringView());
+    }
+
+    void StreamWriter::visit(const Bool* obj)
+    {
+        if (obj->getValue()) {
+            put("true", 4);
+        } else {
+            put("false", 5);
+        }
+    }
+
+    void StreamWriter::visit(const Null* obj)
+    {
+        (void)(obj);
+        put("null", 4);
+    }
+
+    void StreamWriter::visit(const Number* obj)
+    {
+        char buffer[21];
+        char* end = buffer + sizeof(buffer);
+        if (obj->isInt64()) {
+            const std::int64_t value = obj->getInt64Value();
+            char* first;
+            if (value < 0) {
+                // negate in unsigned arithmetic so the most negative value does not overflow
+                first = detail::formatInteger(end, 0 - static_cast<std::uint64_t>(value));
+                *--first = '-';
+            } else {
+                first = detail::formatInteger(end, static_cast<std::uint64_t>(value));
+            }
+            put(first, end - first);
+        } else if (obj->isUint64()) {
+            char* first = detail::formatInteger(end, obj->getUint64Value());
+            put(first, end - first);
+        } else {
+            char digits[32];
+            char* last = detail::formatDouble(obj->getValue(), digits);
+            put(digits, last - digits);
+        }
+    }
+
+    ValueWriter::ValueWriter()
+        : _writer([this](const char* data, size_t size) { _str.append(data, size); }, 4096) {}
+
+    ValueWriter::ValueWriter(const ValueWriter& other)
+        : ValueWriter()
+    {
+        _str = other._str;
+    }
+
+    ValueWriter::ValueWriter(ValueWriter&& other)
+        : ValueWriter()
+    {
+        _str = std::move(other._str);
+    }
+
+    ValueWriter& ValueWriter::operator=(const ValueWriter& other)
+    {
+        _str = other._str;
+        return *this;
+    }
+
+    ValueWriter& ValueWriter::operator=(ValueWriter&& other)
+    {
+        _str = std::move(other._str);
+        return *this;
+    }
+
+    void ValueWriter::visit(const Object* obj)
+    {
+        _writer.visit(obj);
+        _writer.flush();
+    }
+
+    void ValueWriter::visit(const Array* obj)
+    {
+        _writer.visit(obj);
+        _writer.flush();
+    }
+
+    void ValueWriter::visit(const String* obj)
+    {
+        _writer.visit(obj);
+        _writer.flush();
+    }
+
+    void ValueWriter::visit(const Bool* obj)
+    {
+        _writer.visit(obj);
+        _writer.flush();
+    }
+
+    void ValueWriter::visit(const Null* obj)
+    {
+        _writer.visit(obj);
+        _writer.flush();
+    }
+
+    void ValueWriter::visit(const Number* obj)
+    {
+        _writer.visit(obj);
+        _writer.flush();
+    }
+
+    std::string ValueWriter::getString() const
+    {
+        return _str;
+    }
+
+    Bool::Bool(bool value)
+        : Value(Value::ValueType::BOOL), _value(value) {}
+
+    bool Bool::getValue() const
+    {
+        return _value;
+    }
+
+    Null::Null()
+        : Value(Value::ValueType::JNULL) {}
+
+    void* Null::getValue() const
+    {
+        return nullptr;
+    }
+
+    Number::Number(double value)
+        : Value(Value::ValueType::NUMBER), _numberType(NumberType::DOUBLE), _double(value) {}
+
+    Number::Number(std::int64_t value)
+        : Value(Value::ValueType::NUMBER), _numberType(NumberType::INT64), _int64(value) {}
+
+    Number::Number(std::uint64_t value)
+        : Value(Value::ValueType::NUMBER), _numberType(NumberType::UINT64), _uint64(value) {}
+
+    bool Number::isInteger() const
+    {
+        return _numberType != NumberType::DOUBLE;
+    }
+
+    bool Number::isInt64() const
+    {
+        return _numberType == NumberType::INT64;
+    }
+
+    bool Number::isUint64() const
+    {
+        return _numberType == NumberType::UINT64;
+    }
+
+    bool Number::isDouble() const
+    {
+        return _numberType == NumberType::DOUBLE;
+    }
+
+    double Number::getValue() const
+    {
+        switch (_numberType) {
+        case NumberType::INT64:
+            return static_cast<double>(_int64);
+        case NumberType::UINT64:
+            return static_cast<double>(_uint64);
+        default:
+            return _double;
+        }
+    }
+
+    std::int64_t Number::getInt64Value() const
+    {
+        constexpr auto max = std::numeric_limits<std::int64_t>::max();
+        constexpr auto min = std::numeric_limits<std::int64_t>::min();
+        switch (_numberType) {
+        case NumberType::INT64:
+            return _int64;
+        case NumberType::UINT64:
+            return _uint64 > static_cast<std::uint64_t>(max) ? max : static_cast<std::int64_t>(_uint64);
+        default:
+            if (!(_double > static_cast<double>(min))) {
+                return _double != _double ? 0 : min; // NaN becomes 0
+            }
+            return _double >= static_cast<double>(max) ? max : static_cast<std::int64_t>(_double);
+        }
+    }
+
+    std::uint64_t Number::getUint64Value() const
+    {
+        constexpr auto max = std::numeric_limits<std::uint64_t>::max();
+        switch (_numberType) {
+        case NumberType::INT64:
+            return _int64 < 0 ? 0 : static_cast<std::uint64_t>(_int64);
+        case NumberType::UINT64:
+            return _uint64;
+        default:
+            if (!(_double > 0.0)) {
+                return 0;
+            }
+            return _double >= static_cast<double>(max) ? max : static_cast<std::uint64_t>(_double);
+        }
+    }
+
+    namespace detail {
+
+        template <class... Args>
+        static std::string format(const char* fmt, Args&&... args)
+        {
+            auto len = std::snprintf(nullptr, 0, fmt, std::forward<Args>(args)...) + 1;
+            std::vector<char> buf(len, '\0');
+            std::snprintf(buf.data(), len, fmt, std::forward<Args>(args)...);
+            return buf.data();
+        }
+
+        static int trailingZeros(std::uint64_t bits)
+        {
+#if defined(_MSC_VER) && defined(_M_X64)
+            unsigned long index;
+            _BitScanForward64(&index, bits);
+            return static_cast<int>(index);
+#elif defined(_MSC_VER)
+            unsigned long index;
+            if (_BitScanForward(&index, static_cast<unsigned long>(bits))) {
+                return static_cast<int>(index);
+            }
+            _BitScanForward(&index, static_cast<unsigned long>(bits >> 32));
+            return static_cast<int>(index) + 32;
+#else
+            return __builtin_ctzll(bits);
+#endif
+        }
+
+        // Bit masks of the interesting characters of a 64 byte block, one bit per byte
+        struct BlockMasks {
+            std::uint64_t quote;
+            std::uint64_t backslash;
+            std::uint64_t op;
+            std::uint64_t whitespace;
+        };
+
+        static constexpr size_t BLOCK_SIZE = 64;
+
+#if defined(JSONPP_AVX2)
+        static std::uint64_t maskOf(__m256i lo, __m256i hi)
+        {
+            auto low = static_cast<std::uint32_t>(_mm256_movemask_epi8(lo));
+            auto high = static_cast<std::uint32_t>(_mm256_movemask_epi8(hi));
+            return static_cast<std::uint64_t>(low) | (static_cast<std::uint64_t>(high) << 32);
+        }
+
+        static BlockMasks classifyBlock(const char* block)
+        {
+            const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+            const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+
+            auto eq = [&](char c) {
+                const __m256i v = _mm256_set1_epi8(c);
+                return maskOf(_mm256_cmpeq_epi8(lo, v), _mm256_cmpeq_epi8(hi, v));
+            };
+
+            // '\t' through '\r' are whitespace, which is (c - '\t') <= 4 as an unsigned comparison
+            auto controlWhitespace = [](__m256i v) {
+                const __m256i shifted = _mm256_sub_epi8(v, _mm256_set1_epi8('\t'));
+                return _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8(4)), shifted);
+            };
+
+            BlockMasks masks;
+            masks.quote = eq('\"');
+            masks.backslash = eq('\\');
+            masks.op = eq('{') | eq('}') | eq('[') | eq(']') | eq(':') | eq(',');
+            masks.whitespace = eq(' ') | maskOf(controlWhitespace(lo), controlWhitespace(hi));
+            return masks;
+        }
+#elif defined(JSONPP_SSE2)
+        static std::uint64_t maskOf(__m128i a, __m128i b, __m128i c, __m128i d)
+        {
+            return static_cast<std::uint64_t>(static_cast<std::uint16_t>(_mm_movemask_epi8(a)))
+                | (static_cast<std::uint64_t>(static_cast<std::uint16_t>(_mm_movemask_epi8(b))) << 16)
+                | (static_cast<std::uint64_t>(static_cast<std::uint16_t>(_mm_movemask_epi8(c))) << 32)
+                | (static_cast<std::uint64_t>(static_cast<std::uint16_t>(_mm_movemask_epi8(d))) << 48);
+        }
+
+        static BlockMasks classifyBlock(const char* block)
+        {
+            __m128i chunks[4];
+            for (int i = 0; i < 4; ++i) {
+                chunks[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i * 16));
+            }
+
+            auto eq = [&](char c) {
+                const __m128i v = _mm_set1_epi8(c);
+                return maskOf(_mm_cmpeq_epi8(chunks[0], v), _mm_cmpeq_epi8(chunks[1], v),
+                              _mm_cmpeq_epi8(chunks[2], v), _mm_cmpeq_epi8(chunks[3], v));
+            };
+
+            // '\t' through '\r' are whitespace, which is (c - '\t') <= 4 as an unsigned comparison
+            auto controlWhitespace = [](__m128i v) {
+                const __m128i shifted = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+                return _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(4)), shifted);
+            };
+
+            BlockMasks masks;
+            masks.quote = eq('\"');
+            masks.backslash = eq('\\');
+            masks.op = eq('{') | eq('}') | eq('[') | eq(']') | eq(':') | eq(',');
+            masks.whitespace = eq(' ') | maskOf(controlWhitespace(chunks[0]), controlWhitespace(chunks[1]),
+                                                controlWhitespace(chunks[2]), controlWhitespace(chunks[3]));
+            return masks;
+        }
+#else
+        static BlockMasks classifyBlock(const char* block)
+        {
+            BlockMasks masks = { 0, 0, 0, 0 };
+            for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+                const std::uint64_t bit = static_cast<std::uint64_t>(1) << i;
+                const char c = block[i];
+                if (c == '\"') {
+                    masks.quote |= bit;
+                } else if (c == '\\') {
+                    masks.backslash |= bit;
+                } else if (c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',') {
+                    masks.op |= bit;
+                } else if (c == ' ' || (c >= '\t' && c <= '\r')) {
+                    masks.whitespace |= bit;
+                }
+            }
+            return masks;
+        }
+#endif
+
+        static bool isStringSpecial(char c)
+        {
+            return c == '\"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+        }
+
+        // Finds the first quote, backslash or control character in [first, last) 32 or 16 bytes at a time
+        static const char* findStringSpecial(const char* first, const char* last)
+        {
+#if defined(JSONPP_AVX2)
+            const __m256i quote = _mm256_set1_epi8('\"');
+            const __m256i backslash = _mm256_set1_epi8('\\');
+            const __m256i control = _mm256_set1_epi8(0x1F);
+            for (; last - first >= 32; first += 32) {
+                const __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+                const __m256i special = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_cmpeq_epi8(chars, quote), _mm256_cmpeq_epi8(chars, backslash)),
+                    _mm256_cmpeq_epi8(_mm256_min_epu8(chars, control), chars));
+                const auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(special));
+                if (mask != 0) {
+                    return first + trailingZeros(mask);
+                }
+            }
+#elif defined(JSONPP_SSE2)
+            const __m128i quote = _mm_set1_epi8('\"');
+            const __m128i backslash = _mm_set1_epi8('\\');
+            const __m128i control = _mm_set1_epi8(0x1F);
+            for (; last - first >= 16; first += 16) {
+                const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+                const __m128i special = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(chars, quote), _mm_cmpeq_epi8(chars, backslash)),
+                    _mm_cmpeq_epi8(_mm_min_epu8(chars, control), chars));
+                const auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(special));
+                if (mask != 0) {
+                    return first + trailingZeros(mask);
+                }
+            }
+#endif
+            while (first != last && !isStringSpecial(*first)) {
+                ++first;
+            }
+            return first;
+        }
+
+        // Finds the characters that follow an unescaped backslash. Runs of backslashes are rare
+        // so they are walked one at a time. The escape state is carried over to the next block.
+        static std::uint64_t findEscaped(std::uint64_t backslash, std::uint64_t& prevEscaped)
+        {
+            std::uint64_t escaped = prevEscaped;
+            prevEscaped = 0;
+            backslash &= ~escaped;
+            while (backslash) {
+                const int i = trailingZeros(backslash);
+                if (i == 63) {
+                    prevEscaped = 1;
+                } else {
+                    escaped |= static_cast<std::uint64_t>(1) << (i + 1);
+                }
+                backslash &= ~((static_cast<std::uint64_t>(1) << i) | escaped);
+            }
+            return escaped;
+        }
+
+        // Every bit becomes the xor of itself and all of the bits below it, which turns
+        // a mask of quotes into a mask of the bytes between an opening and a closing quote.
+        static std::uint64_t prefixXor(std::uint64_t bits)
+        {
+            bits ^= bits << 1;
+            bits ^= bits << 2;
+            bits ^= bits << 4;
+            bits ^= bits << 8;
+            bits ^= bits << 16;
+            bits ^= bits << 32;
+            return bits;
+        }
+
+        static bool isDigit(char c)
+        {
+            return c >= '0' && c <= '9';
+        }
+
+        // The character a short escape such as \n stands for
+        static char decodeShortEscape(char c)
+        {
+            switch (c) {
+            case 'b':
+                return '\b';
+            case 'f':
+                return '\f';
+            case 'n':
+                return '\n';
+            case 'r':
+                return '\r';
+            case 't':
+                return '\t';
+            default:
+                return c; // \" \\ and \/ stand for themselves
+            }
+        }
+
+        static std::uint32_t hexValue(char c)
+        {
+            if (isDigit(c)) {
+                return c - '0';
+            }
+            return std::tolower(static_cast<unsigned char>(c)) - 'a' + 10;
+        }
+
+        static std::uint32_t decodeHex4(const char* digits)
+        {
+            return hexValue(digits[0]) << 12 | hexValue(digits[1]) << 8 | hexValue(digits[2]) << 4 | hexValue(digits[3]);
+        }
+
+        static bool isHighSurrogate(std::uint32_t unit)
+        {
+            return unit >= 0xD800 && unit <= 0xDBFF;
+        }
+
+        static bool isLowSurrogate(std::uint32_t unit)
+        {
+            return unit >= 0xDC00 && unit <= 0xDFFF;
+        }
+
+        static std::uint32_t combineSurrogates(std::uint32_t high, std::uint32_t low)
+        {
+            return 0x10000 + ((high - 0xD800) << 10) + (low - 0xDC00);
+        }
+
+        // Reads the escaped low half of a surrogate pair, e.g. \uDC00, at the start of [first, last)
+        static bool readLowSurrogate(const char* first, const char* last, std::uint32_t& low)
+        {
+            if (last - first < 6 || first[0] != '\\' || first[1] != 'u') {
+                return false;
+            }
+            for (int i = 2; i < 6; ++i) {
+                if (!std::isxdigit(static_cast<unsigned char>(first[i]))) {
+                    return false;
+                }
+            }
+            if (last - first > 6 && std::isxdigit(static_cast<unsigned char>(first[6]))) {
+                return false; // too many digits, left for the regular lexing to reject
+            }
+            low = decodeHex4(first + 2);
+            return isLowSurrogate(low);
+        }
+
+        // Surrogates that are not part of a pair cannot be encoded and become U+FFFD
+        static void appendUtf8(std::string& out, std::uint32_t codePoint)
+        {
+            if ((codePoint >= 0xD800 && codePoint <= 0xDFFF) || codePoint > 0x10FFFF) {
+                codePoint = 0xFFFD;
+            }
+            if (codePoint < 0x80) {
+                out += static_cast<char>(codePoint);
+            } else if (codePoint < 0x800) {
+                out += static_cast<char>(0xC0 | (codePoint >> 6));
+                out += static_cast<char>(0x80 | (codePoint & 0x3F));
+            } else if (codePoint < 0x10000) {
+                out += static_cast<char>(0xE0 | (codePoint >> 12));
+                out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (codePoint & 0x3F));
+            } else {
+                out += static_cast<char>(0xF0 | (codePoint >> 18));
+                out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (codePoint & 0x3F));
+            }
+        }
+
+#if defined(_MSC_VER) || (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define JSONPP_LITTLE_ENDIAN
+#endif
+
+#if defined(JSONPP_LITTLE_ENDIAN)
+        // SWAR (SIMD within a register) digit handling: the eight characters are loaded into one
+        // 64 bit integer with the first character in the lowest byte.
+        static bool isEightDigits(std::uint64_t chars)
+        {
+            return (((chars & 0xF0F0F0F0F0F0F0F0) | (((chars + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) == 0x3333333333333333);
+        }
+
+        static std::uint64_t parseEightDigits(std::uint64_t chars)
+        {
+            const std::uint64_t mask = 0x000000FF000000FF;
+            const std::uint64_t mul1 = 0x000F424000000064; // 100 + (1000000ULL << 32)
+            const std::uint64_t mul2 = 0x0000271000000001; // 1 + (10000ULL << 32)
+            chars -= 0x3030303030303030;
+            chars = (chars * 10) + (chars >> 8); // pairs of digits
+            return (((chars & mask) * mul1) + (((chars >> 16) & mask) * mul2)) >> 32;
+        }
+#endif
+
+        // Accumulates the digits starting at first into value (wrapping on overflow) and returns the end of the digits
+        static const char* parseDigits(const char* first, const char* last, std::uint64_t& value)
+        {
+#if defined(JSONPP_LITTLE_ENDIAN)
+            while (last - first >= 8) {
+                std::uint64_t chars;
+                std::memcpy(&chars, first, sizeof(chars));
+                if (!isEightDigits(chars)) {
+                    break;
+                }
+                value = value * 100000000 + parseEightDigits(chars);
+                first += 8;
+            }
+#endif
+            for (; first != last && isDigit(*first); ++first) {
+                value = value * 10 + static_cast<std::uint64_t>(*first - '0');
+            }
+            return first;
+        }
+
+        // A number as written in the text: (-1)^negative * mantissa * 10^exponent
+        struct DecimalNumber {
+            bool valid = false;
+            bool negative = false;
+            bool truncated = false; // more than 19 significant digits were written so the mantissa was cut short
+            bool integral = false; // written without a fraction or exponent
+            std::uint64_t mantissa = 0;
+            std::int64_t exponent = 0;
+        };
+
+        static constexpr size_t MAX_MANTISSA_DIGITS = 19;
+
+        /**
+         * Scans [+-]digits[.digits][(e|E)[+-]digits] starting at first. Returns the end of the number or,
+         * when a required digit is missing, the character where the digit was expected.
+         */
+        static const char* scanNumber(const char* first, const char* last, DecimalNumber& number)
+        {
+            const char* p = first;
+            if (*p == '+' || *p == '-') {
+                number.negative = *p == '-';
+                ++p;
+            }
+
+            const char* integerFirst = p;
+            p = parseDigits(p, last, number.mantissa);
+            const char* integerLast = p;
+            if (integerFirst == integerLast) {
+                return p;
+            }
+
+            const char* fractionFirst = p;
+            const char* fractionLast = p;
+            if (p != last && *p == '.') {
+                fractionFirst = ++p;
+                p = parseDigits(p, last, number.mantissa);
+                fractionLast = p;
+                if (fractionFirst == fractionLast) {
+                    return p;
+                }
+            }
+
+            std::int64_t exponent = 0;
+            if (p != last && (*p == 'e' || *p == 'E')) {
+                ++p;
+                bool negativeExponent = false;
+                if (p != last && (*p == '+' || *p == '-')) {
+                    negativeExponent = *p == '-';
+                    ++p;
+                }
+                if (p == last || !isDigit(*p)) {
+                    return p;
+                }
+                for (; p != last && isDigit(*p); ++p) {
+                    if (exponent < 0x10000000) { // anything larger is out of range anyway
+                        exponent = exponent * 10 + (*p - '0');
+                    }
+                }
+                if (negativeExponent) {
+                    exponent = -exponent;
+                }
+            }
+            number.valid = true;
+            number.integral = fractionLast == integerLast && p == integerLast;
+            number.exponent = exponent - (fractionLast - fractionFirst);
+
+            // count the significant digits and redo the mantissa from the first 19 of them if there are too many
+            const char* significant = integerFirst;
+            while (significant != integerLast && *significant == '0') {
+                ++significant;
+            }
+            size_t digits = (integerLast - significant) + (fractionLast - fractionFirst);
+            if (significant == integerLast) {
+                significant = fractionFirst;
+                while (significant != fractionLast && *significant == '0') {
+                    ++significant;
+                }
+                digits = fractionLast - significant;
+            }
+
+            if (digits > MAX_MANTISSA_DIGITS) {
+                number.truncated = true;
+                number.mantissa = 0;
+                size_t taken = 0;
+                const char* it = significant;
+                if (significant < integerLast) {
+                    for (; it != integerLast && taken < MAX_MANTISSA_DIGITS; ++it, ++taken) {
+                        number.mantissa = number.mantissa * 10 + static_cast<std::uint64_t>(*it - '0');
+                    }
+                }
+                if (it == integerLast || significant >= fractionFirst) {
+                    it = significant >= fractionFirst ? significant : fractionFirst;
+                    for (; it != fractionLast && taken < MAX_MANTISSA_DIGITS; ++it, ++taken) {
+                        number.mantissa = number.mantissa * 10 + static_cast<std::uint64_t>(*it - '0');
+                    }
+                    number.exponent = exponent - (it - fractionFirst);
+                } else {
+                    number.exponent = exponent + (integerLast - it);
+                }
+            }
+            return p;
+        }
+
+        // The 128 bit truncated (rounded up for negative powers) values of 5^q normalized so the top bit is set,
+        // for q in [-342, 308]. Two 64 bit words per power, most significant first.
+        static constexpr int SMALLEST_POWER_OF_TEN = -342;
+        static constexpr int LARGEST_POWER_OF_TEN = 308;
+        static const std::uint64_t POWERS_OF_FIVE[] = {
+            0xeef453d6923bd65a, 0x113faa2906a13b3f,
+            0x9558b4661b6565f8, 0x4ac7ca59a424c507,
+            0xbaaee17fa23ebf76, 0x5d79bcf00d2df649,
+            0xe95a99df8ace6f53, 0xf4d82c2c107973dc,
+            0x91d8a02bb6c10594, 0x79071b9b8a4be869,
+            0xb64ec836a47146f9, 0x9748e2826cdee284,
+            0xe3e27a444d8d98b7, 0xfd1b1b2308169b25,
+            0x8e6d8c6ab0787f72, 0xfe30f0f5e50e20f7,
+            0xb208ef855c969f4f, 0xbdbd2d335e51a935,
+            0xde8b2b66b3bc4723, 0xad2c788035e61382,
+            0x8b16fb203055ac76, 0x4c3bcb5021afcc31,
+            0xaddcb9e83c6b1793, 0xdf4abe242a1bbf3d,
+            0xd953e8624b85dd78, 0xd71d6dad34a2af0d,
+            0x87d4713d6f33aa6b, 0x8672648c40e5ad68,
+            0xa9c98d8ccb009506, 0x680efdaf511f18c2,
+            0xd43bf0effdc0ba48, 0x0212bd1b2566def2,
+            0x84a57695fe98746d, 0x014bb630f7604b57,
+            0xa5ced43b7e3e9188, 0x419ea3bd35385e2d,
+            0xcf42894a5dce35ea, 0x52064cac828675b9,
+            0x818995ce7aa0e1b2, 0x7343efebd1940993,
+            0xa1ebfb4219491a1f, 0x1014ebe6c5f90bf8,
+            0xca66fa129f9b60a6, 0xd41a26e077774ef6,
+            0xfd00b897478238d0, 0x8920b098955522b4,
+            0x9e20735e8cb16382, 0x55b46e5f5d5535b0,
+            0xc5a890362fddbc62, 0xeb2189f734aa831d,
+            0xf712b443bbd52b7b, 0xa5e9ec7501d523e4,
+            0x9a6bb0aa55653b2d, 0x47b233c92125366e,
+            0xc1069cd4eabe89f8, 0x999ec0bb696e840a,
+            0xf148440a256e2c76, 0xc00670ea43ca250d,
+            0x96cd2a865764dbca, 0x380406926a5e5728,
+            0xbc807527ed3e12bc, 0xc605083704f5ecf2,
+            0xeba09271e88d976b, 0xf7864a44c633682e,
+            0x93445b8731587ea3, 0x7ab3ee6afbe0211d,
+            0xb8157268fdae9e4c, 0x5960ea05bad82964,
+            0xe61acf033d1a45df, 0x6fb92487298e33bd,
+            0x8fd0c16206306bab, 0xa5d3b6d479f8e056,
+            0xb3c4f1ba87bc8696, 0x8f48a4899877186c,
+            0xe0b62e2929aba83c, 0x331acdabfe94de87,
+            0x8c71dcd9ba0b4925, 0x9ff0c08b7f1d0b14,
+            0xaf8e5410288e1b6f, 0x07ecf0ae5ee44dd9,
+            0xdb71e91432b1a24a, 0xc9e82cd9f69d6150,
+            0x892731ac9faf056e, 0xbe311c083a225cd2,
+            0xab70fe17c79ac6ca, 0x6dbd630a48aaf406,
+            0xd64d3d9db981787d, 0x092cbbccdad5b108,
+            0x85f0468293f0eb4e, 0x25bbf56008c58ea5,
+            0xa76c582338ed2621, 0xaf2af2b80af6f24e,
+            0xd1476e2c07286faa, 0x1af5af660db4aee1,
+            0x82cca4db847945ca, 0x50d98d9fc890ed4d,
+            0xa37fce126597973c, 0xe50ff107bab528a0,
+            0xcc5fc196fefd7d0c, 0x1e53ed49a96272c8,
+            0xff77b1fcbebcdc4f, 0x25e8e89c13bb0f7a,
+            0x9faacf3df73609b1, 0x77b191618c54e9ac,
+            0xc795830d75038c1d, 0xd59df5b9ef6a2417,
+            0xf97ae3d0d2446f25, 0x4b0573286b44ad1d,
+            0x9becce62836ac577, 0x4ee367f9430aec32,
+            0xc2e801fb244576d5, 0x229c41f793cda73f,
+            0xf3a20279ed56d48a, 0x6b43527578c1110f,
+            0x9845418c345644d6, 0x830a13896b78aaa9,
+            0xbe5691ef416bd60c, 0x23cc986bc656d553,
+            0xedec366b11c6cb8f, 0x2cbfbe86b7ec8aa8,
+            0x94b3a202eb1c3f39, 0x7bf7d71432f3d6a9,
+            0xb9e08a83a5e34f07, 0xdaf5ccd93fb0cc53,
+            0xe858ad248f5c22c9, 0xd1b3400f8f9cff68,
+            0x91376c36d99995be, 0x23100809b9c21fa1,
+            0xb58547448ffffb2d, 0xabd40a0c2832a78a,
+            0xe2e69915b3fff9f9, 0x16c90c8f323f516c,
+            0x8dd01fad907ffc3b, 0xae3da7d97f6792e3,
+            0xb1442798f49ffb4a, 0x99cd11cfdf41779c,
+            0xdd95317f31c7fa1d, 0x40405643d711d583,
+            0x8a7d3eef7f1cfc52, 0x482835ea666b2572,
+            0xad1c8eab5ee43b66, 0xda3243650005eecf,
+            0xd863b256369d4a40, 0x90bed43e40076a82,
+            0x873e4f75e2224e68, 0x5a7744a6e804a291,
+            0xa90de3535aaae202, 0x711515d0a205cb36,
+            0xd3515c2831559a83, 0x0d5a5b44ca873e03,
+            0x8412d9991ed58091, 0xe858790afe9486c2,
+            0xa5178fff668ae0b6, 0x626e974dbe39a872,
+            0xce5d73ff402d98e3, 0xfb0a3d212dc8128f,
+            0x80fa687f881c7f8e, 0x7ce66634bc9d0b99,
+            0xa139029f6a239f72, 0x1c1fffc1ebc44e80,
+            0xc987434744ac874e, 0xa327ffb266b56220,
+            0xfbe9141915d7a922, 0x4bf1ff9f0062baa8,
+            0x9d71ac8fada6c9b5, 0x6f773fc3603db4a9,
+            0xc4ce17b399107c22, 0xcb550fb4384d21d3,
+            0xf6019da07f549b2b, 0x7e2a53a146606a48,
+            0x99c102844f94e0fb, 0x2eda7444cbfc426d,
+            0xc0314325637a1939, 0xfa911155fefb5308,
+            0xf03d93eebc589f88, 0x793555ab7eba27ca,
+            0x96267c7535b763b5, 0x4bc1558b2f3458de,
+            0xbbb01b9283253ca2, 0x9eb1aaedfb016f16,
+            0xea9c227723ee8bcb, 0x465e15a979c1cadc,
+            0x92a1958a7675175f, 0x0bfacd89ec191ec9,
+            0xb749faed14125d36, 0xcef980ec671f667b,
+            0xe51c79a85916f484, 0x82b7e12780e7401a,
+            0x8f31cc0937ae58d2, 0xd1b2ecb8b0908810,
+            0xb2fe3f0b8599ef07, 0x861fa7e6dcb4aa15,
+            0xdfbdcece67006ac9, 0x67a791e093e1d49a,
+            0x8bd6a141006042bd, 0xe0c8bb2c5c6d24e0,
+            0xaecc49914078536d, 0x58fae9f773886e18,
+            0xda7f5bf590966848, 0xaf39a475506a899e,
+            0x888f99797a5e012d, 0x6d8406c952429603,
+            0xaab37fd7d8f58178, 0xc8e5087ba6d33b83,
+            0xd5605fcdcf32e1d6, 0xfb1e4a9a90880a64,
+            0x855c3be0a17fcd26, 0x5cf2eea09a55067f,
+            0xa6b34ad8c9dfc06f, 0xf42faa48c0ea481e,
+            0xd0601d8efc57b08b, 0xf13b94daf124da26,
+            0x823c12795db6ce57, 0x76c53d08d6b70858,
+            0xa2cb1717b52481ed, 0x54768c4b0c64ca6e,
+            0xcb7ddcdda26da268, 0xa9942f5dcf7dfd09,
+            0xfe5d54150b090b02, 0xd3f93b35435d7c4c,
+            0x9efa548d26e5a6e1, 0xc47bc5014a1a6daf,
+            0xc6b8e9b0709f109a, 0x359ab6419ca1091b,
+            0xf867241c8cc6d4c0, 0xc30163d203c94b62,
+            0x9b407691d7fc44f8, 0x79e0de63425dcf1d,
+            0xc21094364dfb5636, 0x985915fc12f542e4,
+            0xf294b943e17a2bc4, 0x3e6f5b7b17b2939d,
+            0x979cf3ca6cec5b5a, 0xa705992ceecf9c42,
+            0xbd8430bd08277231, 0x50c6ff782a838353,
+            0xece53cec4a314ebd, 0xa4f8bf5635246428,
+            0x940f4613ae5ed136, 0x871b7795e136be99,
+            0xb913179899f68584, 0x28e2557b59846e3f,
+            0xe757dd7ec07426e5, 0x331aeada2fe589cf,
+            0x9096ea6f3848984f, 0x3ff0d2c85def7621,
+            0xb4bca50b065abe63, 0x0fed077a756b53a9,
+            0xe1ebce4dc7f16dfb, 0xd3e8495912c62894,
+            0x8d3360f09cf6e4bd, 0x64712dd7abbbd95c,
+            0xb080392cc4349dec, 0xbd8d794d96aacfb3,
+            0xdca04777f541c567, 0xecf0d7a0fc5583a0,
+            0x89e42caaf9491b60, 0xf41686c49db57244,
+            0xac5d37d5b79b6239, 0x311c2875c522ced5,
+            0xd77485cb25823ac7, 0x7d633293366b828b,
+            0x86a8d39ef77164bc, 0xae5dff9c02033197,
+            0xa8530886b54dbdeb, 0xd9f57f830283fdfc,
+            0xd267caa862a12d66, 0xd072df63c324fd7b,
+            0x8380dea93da4bc60, 0x4247cb9e59f71e6d,
+            0xa46116538d0deb78, 0x52d9be85f074e608,
+            0xcd795be870516656, 0x67902e276c921f8b,
+            0x806bd9714632dff6, 0x00ba1cd8a3db53b6,
+            0xa086cfcd97bf97f3, 0x80e8a40eccd228a4,
+            0xc8a883c0fdaf7df0, 0x6122cd128006b2cd,
+            0xfad2a4b13d1b5d6c, 0x796b805720085f81,
+            0x9cc3a6eec6311a63, 0xcbe3303674053bb0,
+            0xc3f490aa77bd60fc, 0xbedbfc4411068a9c,
+            0xf4f1b4d515acb93b, 0xee92fb5515482d44,
+            0x991711052d8bf3c5, 0x751bdd152d4d1c4a,
+            0xbf5cd54678eef0b6, 0xd262d45a78a0635d,
+            0xef340a98172aace4, 0x86fb897116c87c34,
+            0x9580869f0e7aac0e, 0xd45d35e6ae3d4da0,
+            0xbae0a846d2195712, 0x8974836059cca109,
+            0xe998d258869facd7, 0x2bd1a438703fc94b,
+            0x91ff83775423cc06, 0x7b6306a34627ddcf,
+            0xb67f6455292cbf08, 0x1a3bc84c17b1d542,
+            0xe41f3d6a7377eeca, 0x20caba5f1d9e4a93,
+            0x8e938662882af53e, 0x547eb47b7282ee9c,
+            0xb23867fb2a35b28d, 0xe99e619a4f23aa43,
+            0xdec681f9f4c31f31, 0x6405fa00e2ec94d4,
+            0x8b3c113c38f9f37e, 0xde83bc408dd3dd04,
+            0xae0b158b4738705e, 0x9624ab50b148d445,
+            0xd98ddaee19068c76, 0x3badd624dd9b0957,
+            0x87f8a8d4cfa417c9, 0xe54ca5d70a80e5d6,
+            0xa9f6d30a038d1dbc, 0x5e9fcf4ccd211f4c,
+            0xd47487cc8470652b, 0x7647c3200069671f,
+            0x84c8d4dfd2c63f3b, 0x29ecd9f40041e073,
+            0xa5fb0a17c777cf09, 0xf468107100525890,
+            0xcf79cc9db955c2cc, 0x7182148d4066eeb4,
+            0x81ac1fe293d599bf, 0xc6f14cd848405530,
+            0xa21727db38cb002f, 0xb8ada00e5a506a7c,
+            0xca9cf1d206fdc03b, 0xa6d90811f0e4851c,
+            0xfd442e4688bd304a, 0x908f4a166d1da663,
+            0x9e4a9cec15763e2e, 0x9a598e4e043287fe,
+            0xc5dd44271ad3cdba, 0x40eff1e1853f29fd,
+            0xf7549530e188c128, 0xd12bee59e68ef47c,
+            0x9a94dd3e8cf578b9, 0x82bb74f8301958ce,
+            0xc13a148e3032d6e7, 0xe36a52363c1faf01,
+            0xf18899b1bc3f8ca1, 0xdc44e6c3cb279ac1,
+            0x96f5600f15a7b7e5, 0x29ab103a5ef8c0b9,
+            0xbcb2b812db11a5de, 0x7415d448f6b6f0e7,
+            0xebdf661791d60f56, 0x111b495b3464ad21,
+            0x936b9fcebb25c995, 0xcab10dd900beec34,
+            0xb84687c269ef3bfb, 0x3d5d514f40eea742,
+            0xe65829b3046b0afa, 0x0cb4a5a3112a5112,
+            0x8ff71a0fe2c2e6dc, 0x47f0e785eaba72ab,
+            0xb3f4e093db73a093, 0x59ed216765690f56,
+            0xe0f218b8d25088b8, 0x306869c13ec3532c,
+            0x8c974f7383725573, 0x1e414218c73a13fb,
+            0xafbd2350644eeacf, 0xe5d1929ef90898fa,
+            0xdbac6c247d62a583, 0xdf45f746b74abf39,
+            0x894bc396ce5da772, 0x6b8bba8c328eb783,
+            0xab9eb47c81f5114f, 0x066ea92f3f326564,
+            0xd686619ba27255a2, 0xc80a537b0efefebd,
+            0x8613fd0145877585, 0xbd06742ce95f5f36,
+            0xa798fc4196e952e7, 0x2c48113823b73704,
+            0xd17f3b51fca3a7a0, 0xf75a15862ca504c5,
+            0x82ef85133de648c4, 0x9a984d73dbe722fb,
+            0xa3ab66580d5fdaf5, 0xc13e60d0d2e0ebba,
+            0xcc963fee10b7d1b3, 0x318df905079926a8,
+            0xffbbcfe994e5c61f, 0xfdf17746497f7052,
+            0x9fd561f1fd0f9bd3, 0xfeb6ea8bedefa633,
+            0xc7caba6e7c5382c8, 0xfe64a52ee96b8fc0,
+            0xf9bd690a1b68637b, 0x3dfdce7aa3c673b0,
+            0x9c1661a651213e2d, 0x06bea10ca65c084e,
+            0xc31bfa0fe5698db8, 0x486e494fcff30a62,
+            0xf3e2f893dec3f126, 0x5a89dba3c3efccfa,
+            0x986ddb5c6b3a76b7, 0xf89629465a75e01c,
+            0xbe89523386091465, 0xf6bbb397f1135823,
+            0xee2ba6c0678b597f, 0x746aa07ded582e2c,
+            0x94db483840b717ef, 0xa8c2a44eb4571cdc,
+            0xba121a4650e4ddeb, 0x92f34d62616ce413,
+            0xe896a0d7e51e1566, 0x77b020baf9c81d17,
+            0x915e2486ef32cd60, 0x0ace1474dc1d122e,
+            0xb5b5ada8aaff80b8, 0x0d819992132456ba,
+            0xe3231912d5bf60e6, 0x10e1fff697ed6c69,
+            0x8df5efabc5979c8f, 0xca8d3ffa1ef463c1,
+            0xb1736b96b6fd83b3, 0xbd308ff8a6b17cb2,
+            0xddd0467c64bce4a0, 0xac7cb3f6d05ddbde,
+            0x8aa22c0dbef60ee4, 0x6bcdf07a423aa96b,
+            0xad4ab7112eb3929d, 0x86c16c98d2c953c6,
+            0xd89d64d57a607744, 0xe871c7bf077ba8b7,
+            0x87625f056c7c4a8b, 0x11471cd764ad4972,
+            0xa93af6c6c79b5d2d, 0xd598e40d3dd89bcf,
+            0xd389b47879823479, 0x4aff1d108d4ec2c3,
+            0x843610cb4bf160cb, 0xcedf722a585139ba,
+            0xa54394fe1eedb8fe, 0xc2974eb4ee658828,
+            0xce947a3da6a9273e, 0x733d226229feea32,
+            0x811ccc668829b887, 0x0806357d5a3f525f,
+            0xa163ff802a3426a8, 0xca07c2dcb0cf26f7,
+            0xc9bcff6034c13052, 0xfc89b393dd02f0b5,
+            0xfc2c3f3841f17c67, 0xbbac2078d443ace2,
+            0x9d9ba7832936edc0, 0xd54b944b84aa4c0d,
+            0xc5029163f384a931, 0x0a9e795e65d4df11,
+            0xf64335bcf065d37d, 0x4d4617b5ff4a16d5,
+            0x99ea0196163fa42e, 0x504bced1bf8e4e45,
+            0xc06481fb9bcf8d39, 0xe45ec2862f71e1d6,
+            0xf07da27a82c37088, 0x5d767327bb4e5a4c,
+            0x964e858c91ba2655, 0x3a6a07f8d510f86f,
+            0xbbe226efb628afea, 0x890489f70a55368b,
+            0xeadab0aba3b2dbe5, 0x2b45ac74ccea842e,
+            0x92c8ae6b464fc96f, 0x3b0b8bc90012929d,
+            0xb77ada0617e3bbcb, 0x09ce6ebb40173744,
+            0xe55990879ddcaabd, 0xcc420a6a101d0515,
+            0x8f57fa54c2a9eab6, 0x9fa946824a12232d,
+            0xb32df8e9f3546564, 0x47939822dc96abf9,
+            0xdff9772470297ebd, 0x59787e2b93bc56f7,
+            0x8bfbea76c619ef36, 0x57eb4edb3c55b65a,
+            0xaefae51477a06b03, 0xede622920b6b23f1,
+            0xdab99e59958885c4, 0xe95fab368e45eced,
+            0x88b402f7fd75539b, 0x11dbcb0218ebb414,
+            0xaae103b5fcd2a881, 0xd652bdc29f26a119,
+            0xd59944a37c0752a2, 0x4be76d3346f0495f,
+            0x857fcae62d8493a5, 0x6f70a4400c562ddb,
+            0xa6dfbd9fb8e5b88e, 0xcb4ccd500f6bb952,
+            0xd097ad07a71f26b2, 0x7e2000a41346a7a7,
+            0x825ecc24c873782f, 0x8ed400668c0c28c8,
+            0xa2f67f2dfa90563b, 0x728900802f0f32fa,
+            0xcbb41ef979346bca, 0x4f2b40a03ad2ffb9,
+            0xfea126b7d78186bc, 0xe2f610c84987bfa8,
+            0x9f24b832e6b0f436, 0x0dd9ca7d2df4d7c9,
+            0xc6ede63fa05d3143, 0x91503d1c79720dbb,
+            0xf8a95fcf88747d94, 0x75a44c6397ce912a,
+            0x9b69dbe1b548ce7c, 0xc986afbe3ee11aba,
+            0xc24452da229b021b, 0xfbe85badce996168,
+            0xf2d56790ab41c2a2, 0xfae27299423fb9c3,
+            0x97c560ba6b0919a5, 0xdccd879fc967d41a,
+            0xbdb6b8e905cb600f, 0x5400e987bbc1c920,
+            0xed246723473e3813, 0x290123e9aab23b68,
+            0x9436c0760c86e30b, 0xf9a0b6720aaf6521,
+            0xb94470938fa89bce, 0xf808e40e8d5b3e69,
+            0xe7958cb87392c2c2, 0xb60b1d1230b20e04,
+            0x90bd77f3483bb9b9, 0xb1c6f22b5e6f48c2,
+            0xb4ecd5f01a4aa828, 0x1e38aeb6360b1af3,
+            0xe2280b6c20dd5232, 0x25c6da63c38de1b0,
+            0x8d590723948a535f, 0x579c487e5a38ad0e,
+            0xb0af48ec79ace837, 0x2d835a9df0c6d851,
+            0xdcdb1b2798182244, 0xf8e431456cf88e65,
+            0x8a08f0f8bf0f156b, 0x1b8e9ecb641b58ff,
+            0xac8b2d36eed2dac5, 0xe272467e3d222f3f,
+            0xd7adf884aa879177, 0x5b0ed81dcc6abb0f,
+            0x86ccbb52ea94baea, 0x98e947129fc2b4e9,
+            0xa87fea27a539e9a5, 0x3f2398d747b36224,
+            0xd29fe4b18e88640e, 0x8eec7f0d19a03aad,
+            0x83a3eeeef9153e89, 0x1953cf68300424ac,
+            0xa48ceaaab75a8e2b, 0x5fa8c3423c052dd7,
+            0xcdb02555653131b6, 0x3792f412cb06794d,
+            0x808e17555f3ebf11, 0xe2bbd88bbee40bd0,
+            0xa0b19d2ab70e6ed6, 0x5b6aceaeae9d0ec4,
+            0xc8de047564d20a8b, 0xf245825a5a445275,
+            0xfb158592be068d2e, 0xeed6e2f0f0d56712,
+            0x9ced737bb6c4183d, 0x55464dd69685606b,
+            0xc428d05aa4751e4c, 0xaa97e14c3c26b886,
+            0xf53304714d9265df, 0xd53dd99f4b3066a8,
+            0x993fe2c6d07b7fab, 0xe546a8038efe4029,
+            0xbf8fdb78849a5f96, 0xde98520472bdd033,
+            0xef73d256a5c0f77c, 0x963e66858f6d4440,
+            0x95a8637627989aad, 0xdde7001379a44aa8,
+            0xbb127c53b17ec159, 0x5560c018580d5d52,
+            0xe9d71b689dde71af, 0xaab8f01e6e10b4a6,
+            0x9226712162ab070d, 0xcab3961304ca70e8,
+            0xb6b00d69bb55c8d1, 0x3d607b97c5fd0d22,
+            0xe45c10c42a2b3b05, 0x8cb89a7db77c506a,
+            0x8eb98a7a9a5b04e3, 0x77f3608e92adb242,
+            0xb267ed1940f1c61c, 0x55f038b237591ed3,
+            0xdf01e85f912e37a3, 0x6b6c46dec52f6688,
+            0x8b61313bbabce2c6, 0x2323ac4b3b3da015,
+            0xae397d8aa96c1b77, 0xabec975e0a0d081a,
+            0xd9c7dced53c72255, 0x96e7bd358c904a21,
+            0x881cea14545c7575, 0x7e50d64177da2e54,
+            0xaa242499697392d2, 0xdde50bd1d5d0b9e9,
+            0xd4ad2dbfc3d07787, 0x955e4ec64b44e864,
+            0x84ec3c97da624ab4, 0xbd5af13bef0b113e,
+            0xa6274bbdd0fadd61, 0xecb1ad8aeacdd58e,
+            0xcfb11ead453994ba, 0x67de18eda5814af2,
+            0x81ceb32c4b43fcf4, 0x80eacf948770ced7,
+            0xa2425ff75e14fc31, 0xa1258379a94d028d,
+            0xcad2f7f5359a3b3e, 0x096ee45813a04330,
+            0xfd87b5f28300ca0d, 0x8bca9d6e188853fc,
+            0x9e74d1b791e07e48, 0x775ea264cf55347e,
+            0xc612062576589dda, 0x95364afe032a819e,
+            0xf79687aed3eec551, 0x3a83ddbd83f52205,
+            0x9abe14cd44753b52, 0xc4926a9672793543,
+            0xc16d9a0095928a27, 0x75b7053c0f178294,
+            0xf1c90080baf72cb1, 0x5324c68b12dd6339,
+            0x971da05074da7bee, 0xd3f6fc16ebca5e04,
+            0xbce5086492111aea, 0x88f4bb1ca6bcf585,
+            0xec1e4a7db69561a5, 0x2b31e9e3d06c32e6,
+            0x9392ee8e921d5d07, 0x3aff322e62439fd0,
+            0xb877aa3236a4b449, 0x09befeb9fad487c3,
+            0xe69594bec44de15b, 0x4c2ebe687989a9b4,
+            0x901d7cf73ab0acd9, 0x0f9d37014bf60a11,
+            0xb424dc35095cd80f, 0x538484c19ef38c95,
+            0xe12e13424bb40e13, 0x2865a5f206b06fba,
+            0x8cbccc096f5088cb, 0xf93f87b7442e45d4,
+            0xafebff0bcb24aafe, 0xf78f69a51539d749,
+            0xdbe6fecebdedd5be, 0xb573440e5a884d1c,
+            0x89705f4136b4a597, 0x31680a88f8953031,
+            0xabcc77118461cefc, 0xfdc20d2b36ba7c3e,
+            0xd6bf94d5e57a42bc, 0x3d32907604691b4d,
+            0x8637bd05af6c69b5, 0xa63f9a49c2c1b110,
+            0xa7c5ac471b478423, 0x0fcf80dc33721d54,
+            0xd1b71758e219652b, 0xd3c36113404ea4a9,
+            0x83126e978d4fdf3b, 0x645a1cac083126ea,
+            0xa3d70a3d70a3d70a, 0x3d70a3d70a3d70a4,
+            0xcccccccccccccccc, 0xcccccccccccccccd,
+            0x8000000000000000, 0x0000000000000000,
+            0xa000000000000000, 0x0000000000000000,
+            0xc800000000000000, 0x0000000000000000,
+            0xfa00000000000000, 0x0000000000000000,
+            0x9c40000000000000, 0x0000000000000000,
+            0xc350000000000000, 0x0000000000000000,
+            0xf424000000000000, 0x0000000000000000,
+            0x9896800000000000, 0x0000000000000000,
+            0xbebc200000000000, 0x0000000000000000,
+            0xee6b280000000000, 0x0000000000000000,
+            0x9502f90000000000, 0x0000000000000000,
+            0xba43b74000000000, 0x0000000000000000,
+            0xe8d4a51000000000, 0x0000000000000000,
+            0x9184e72a00000000, 0x0000000000000000,
+            0xb5e620f480000000, 0x0000000000000000,
+            0xe35fa931a0000000, 0x0000000000000000,
+            0x8e1bc9bf04000000, 0x0000000000000000,
+            0xb1a2bc2ec5000000, 0x0000000000000000,
+            0xde0b6b3a76400000, 0x0000000000000000,
+            0x8ac7230489e80000, 0x0000000000000000,
+            0xad78ebc5ac620000, 0x0000000000000000,
+            0xd8d726b7177a8000, 0x0000000000000000,
+            0x878678326eac9000, 0x0000000000000000,
+            0xa968163f0a57b400, 0x0000000000000000,
+            0xd3c21bcecceda100, 0x0000000000000000,
+            0x84595161401484a0, 0x0000000000000000,
+            0xa56fa5b99019a5c8, 0x0000000000000000,
+            0xcecb8f27f4200f3a, 0x0000000000000000,
+            0x813f3978f8940984, 0x4000000000000000,
+            0xa18f07d736b90be5, 0x5000000000000000,
+            0xc9f2c9cd04674ede, 0xa400000000000000,
+            0xfc6f7c4045812296, 0x4d00000000000000,
+            0x9dc5ada82b70b59d, 0xf020000000000000,
+            0xc5371912364ce305, 0x6c28000000000000,
+            0xf684df56c3e01bc6, 0xc732000000000000,
+            0x9a130b963a6c115c, 0x3c7f400000000000,
+            0xc097ce7bc90715b3, 0x4b9f100000000000,
+            0xf0bdc21abb48db20, 0x1e86d40000000000,
+            0x96769950b50d88f4, 0x1314448000000000,
+            0xbc143fa4e250eb31, 0x17d955a000000000,
+            0xeb194f8e1ae525fd, 0x5dcfab0800000000,
+            0x92efd1b8d0cf37be, 0x5aa1cae500000000,
+            0xb7abc627050305ad, 0xf14a3d9e40000000,
+            0xe596b7b0c643c719, 0x6d9ccd05d0000000,
+            0x8f7e32ce7bea5c6f, 0xe4820023a2000000,
+            0xb35dbf821ae4f38b, 0xdda2802c8a800000,
+            0xe0352f62a19e306e, 0xd50b2037ad200000,
+            0x8c213d9da502de45, 0x4526f422cc340000,
+            0xaf298d050e4395d6, 0x9670b12b7f410000,
+            0xdaf3f04651d47b4c, 0x3c0cdd765f114000,
+            0x88d8762bf324cd0f, 0xa5880a69fb6ac800,
+            0xab0e93b6efee0053, 0x8eea0d047a457a00,
+            0xd5d238a4abe98068, 0x72a4904598d6d880,
+            0x85a36366eb71f041, 0x47a6da2b7f864750,
+            0xa70c3c40a64e6c51, 0x999090b65f67d924,
+            0xd0cf4b50cfe20765, 0xfff4b4e3f741cf6d,
+            0x82818f1281ed449f, 0xbff8f10e7a8921a4,
+            0xa321f2d7226895c7, 0xaff72d52192b6a0d,
+            0xcbea6f8ceb02bb39, 0x9bf4f8a69f764490,
+            0xfee50b7025c36a08, 0x02f236d04753d5b4,
+            0x9f4f2726179a2245, 0x01d762422c946590,
+            0xc722f0ef9d80aad6, 0x424d3ad2b7b97ef5,
+            0xf8ebad2b84e0d58b, 0xd2e0898765a7deb2,
+            0x9b934c3b330c8577, 0x63cc55f49f88eb2f,
+            0xc2781f49ffcfa6d5, 0x3cbf6b71c76b25fb,
+            0xf316271c7fc3908a, 0x8bef464e3945ef7a,
+            0x97edd871cfda3a56, 0x97758bf0e3cbb5ac,
+            0xbde94e8e43d0c8ec, 0x3d52eeed1cbea317,
+            0xed63a231d4c4fb27, 0x4ca7aaa863ee4bdd,
+            0x945e455f24fb1cf8, 0x8fe8caa93e74ef6a,
+            0xb975d6b6ee39e436, 0xb3e2fd538e122b44,
+            0xe7d34c64a9c85d44, 0x60dbbca87196b616,
+            0x90e40fbeea1d3a4a, 0xbc8955e946fe31cd,
+            0xb51d13aea4a488dd, 0x6babab6398bdbe41,
+            0xe264589a4dcdab14, 0xc696963c7eed2dd1,
+            0x8d7eb76070a08aec, 0xfc1e1de5cf543ca2,
+            0xb0de65388cc8ada8, 0x3b25a55f43294bcb,
+            0xdd15fe86affad912, 0x49ef0eb713f39ebe,
+            0x8a2dbf142dfcc7ab, 0x6e3569326c784337,
+            0xacb92ed9397bf996, 0x49c2c37f07965404,
+            0xd7e77a8f87daf7fb, 0xdc33745ec97be906,
+            0x86f0ac99b4e8dafd, 0x69a028bb3ded71a3,
+            0xa8acd7c0222311bc, 0xc40832ea0d68ce0c,
+            0xd2d80db02aabd62b, 0xf50a3fa490c30190,
+            0x83c7088e1aab65db, 0x792667c6da79e0fa,
+            0xa4b8cab1a1563f52, 0x577001b891185938,
+            0xcde6fd5e09abcf26, 0xed4c0226b55e6f86,
+            0x80b05e5ac60b6178, 0x544f8158315b05b4,
+            0xa0dc75f1778e39d6, 0x696361ae3db1c721,
+            0xc913936dd571c84c, 0x03bc3a19cd1e38e9,
+            0xfb5878494ace3a5f, 0x04ab48a04065c723,
+            0x9d174b2dcec0e47b, 0x62eb0d64283f9c76,
+            0xc45d1df942711d9a, 0x3ba5d0bd324f8394,
+            0xf5746577930d6500, 0xca8f44ec7ee36479,
+            0x9968bf6abbe85f20, 0x7e998b13cf4e1ecb,
+            0xbfc2ef456ae276e8, 0x9e3fedd8c321a67e,
+            0xefb3ab16c59b14a2, 0xc5cfe94ef3ea101e,
+            0x95d04aee3b80ece5, 0xbba1f1d158724a12,
+            0xbb445da9ca61281f, 0x2a8a6e45ae8edc97,
+            0xea1575143cf97226, 0xf52d09d71a3293bd,
+            0x924d692ca61be758, 0x593c2626705f9c56,
+            0xb6e0c377cfa2e12e, 0x6f8b2fb00c77836c,
+            0xe498f455c38b997a, 0x0b6dfb9c0f956447,
+            0x8edf98b59a373fec, 0x4724bd4189bd5eac,
+            0xb2977ee300c50fe7, 0x58edec91ec2cb657,
+            0xdf3d5e9bc0f653e1, 0x2f2967b66737e3ed,
+            0x8b865b215899f46c, 0xbd79e0d20082ee74,
+            0xae67f1e9aec07187, 0xecd8590680a3aa11,
+            0xda01ee641a708de9, 0xe80e6f4820cc9495,
+            0x884134fe908658b2, 0x3109058d147fdcdd,
+            0xaa51823e34a7eede, 0xbd4b46f0599fd415,
+            0xd4e5e2cdc1d1ea96, 0x6c9e18ac7007c91a,
+            0x850fadc09923329e, 0x03e2cf6bc604ddb0,
+            0xa6539930bf6bff45, 0x84db8346b786151c,
+            0xcfe87f7cef46ff16, 0xe612641865679a63,
+            0x81f14fae158c5f6e, 0x4fcb7e8f3f60c07e,
+            0xa26da3999aef7749, 0xe3be5e330f38f09d,
+            0xcb090c8001ab551c, 0x5cadf5bfd3072cc5,
+            0xfdcb4fa002162a63, 0x73d9732fc7c8f7f6,
+            0x9e9f11c4014dda7e, 0x2867e7fddcdd9afa,
+            0xc646d63501a1511d, 0xb281e1fd541501b8,
+            0xf7d88bc24209a565, 0x1f225a7ca91a4226,
+            0x9ae757596946075f, 0x3375788de9b06958,
+            0xc1a12d2fc3978937, 0x0052d6b1641c83ae,
+            0xf209787bb47d6b84, 0xc0678c5dbd23a49a,
+            0x9745eb4d50ce6332, 0xf840b7ba963646e0,
+            0xbd176620a501fbff, 0xb650e5a93bc3d898,
+            0xec5d3fa8ce427aff, 0xa3e51f138ab4cebe,
+            0x93ba47c980e98cdf, 0xc66f336c36b10137,
+            0xb8a8d9bbe123f017, 0xb80b0047445d4184,
+            0xe6d3102ad96cec1d, 0xa60dc059157491e5,
+            0x9043ea1ac7e41392, 0x87c89837ad68db2f,
+            0xb454e4a179dd1877, 0x29babe4598c311fb,
+            0xe16a1dc9d8545e94, 0xf4296dd6fef3d67a,
+            0x8ce2529e2734bb1d, 0x1899e4a65f58660c,
+            0xb01ae745b101e9e4, 0x5ec05dcff72e7f8f,
+            0xdc21a1171d42645d, 0x76707543f4fa1f73,
+            0x899504ae72497eba, 0x6a06494a791c53a8,
+            0xabfa45da0edbde69, 0x0487db9d17636892,
+            0xd6f8d7509292d603, 0x45a9d2845d3c42b6,
+            0x865b86925b9bc5c2, 0x0b8a2392ba45a9b2,
+            0xa7f26836f282b732, 0x8e6cac7768d7141e,
+            0xd1ef0244af2364ff, 0x3207d795430cd926,
+            0x8335616aed761f1f, 0x7f44e6bd49e807b8,
+            0xa402b9c5a8d3a6e7, 0x5f16206c9c6209a6,
+            0xcd036837130890a1, 0x36dba887c37a8c0f,
+            0x802221226be55a64, 0xc2494954da2c9789,
+            0xa02aa96b06deb0fd, 0xf2db9baa10b7bd6c,
+            0xc83553c5c8965d3d, 0x6f92829494e5acc7,
+            0xfa42a8b73abbf48c, 0xcb772339ba1f17f9,
+            0x9c69a97284b578d7, 0xff2a760414536efb,
+            0xc38413cf25e2d70d, 0xfef5138519684aba,
+            0xf46518c2ef5b8cd1, 0x7eb258665fc25d69,
+            0x98bf2f79d5993802, 0xef2f773ffbd97a61,
+            0xbeeefb584aff8603, 0xaafb550ffacfd8fa,
+            0xeeaaba2e5dbf6784, 0x95ba2a53f983cf38,
+            0x952ab45cfa97a0b2, 0xdd945a747bf26183,
+            0xba756174393d88df, 0x94f971119aeef9e4,
+            0xe912b9d1478ceb17, 0x7a37cd5601aab85d,
+            0x91abb422ccb812ee, 0xac62e055c10ab33a,
+            0xb616a12b7fe617aa, 0x577b986b314d6009,
+            0xe39c49765fdf9d94, 0xed5a7e85fda0b80b,
+            0x8e41ade9fbebc27d, 0x14588f13be847307,
+            0xb1d219647ae6b31c, 0x596eb2d8ae258fc8,
+            0xde469fbd99a05fe3, 0x6fca5f8ed9aef3bb,
+            0x8aec23d680043bee, 0x25de7bb9480d5854,
+            0xada72ccc20054ae9, 0xaf561aa79a10ae6a,
+            0xd910f7ff28069da4, 0x1b2ba1518094da04,
+            0x87aa9aff79042286, 0x90fb44d2f05d0842,
+            0xa99541bf57452b28, 0x353a1607ac744a53,
+            0xd3fa922f2d1675f2, 0x42889b8997915ce8,
+            0x847c9b5d7c2e09b7, 0x69956135febada11,
+            0xa59bc234db398c25, 0x43fab9837e699095,
+            0xcf02b2c21207ef2e, 0x94f967e45e03f4bb,
+            0x8161afb94b44f57d, 0x1d1be0eebac278f5,
+            0xa1ba1ba79e1632dc, 0x6462d92a69731732,
+            0xca28a291859bbf93, 0x7d7b8f7503cfdcfe,
+            0xfcb2cb35e702af78, 0x5cda735244c3d43e,
+            0x9defbf01b061adab, 0x3a0888136afa64a7,
+            0xc56baec21c7a1916, 0x088aaa1845b8fdd0,
+            0xf6c69a72a3989f5b, 0x8aad549e57273d45,
+            0x9a3c2087a63f6399, 0x36ac54e2f678864b,
+            0xc0cb28a98fcf3c7f, 0x84576a1bb416a7dd,
+            0xf0fdf2d3f3c30b9f, 0x656d44a2a11c51d5,
+            0x969eb7c47859e743, 0x9f644ae5a4b1b325,
+            0xbc4665b596706114, 0x873d5d9f0dde1fee,
+            0xeb57ff22fc0c7959, 0xa90cb506d155a7ea,
+            0x9316ff75dd87cbd8, 0x09a7f12442d588f2,
+            0xb7dcbf5354e9bece, 0x0c11ed6d538aeb2f,
+            0xe5d3ef282a242e81, 0x8f1668c8a86da5fa,
+            0x8fa475791a569d10, 0xf96e017d694487bc,
+            0xb38d92d760ec4455, 0x37c981dcc395a9ac,
+            0xe070f78d3927556a, 0x85bbe253f47b1417,
+            0x8c469ab843b89562, 0x93956d7478ccec8e,
+            0xaf58416654a6babb, 0x387ac8d1970027b2,
+            0xdb2e51bfe9d0696a, 0x06997b05fcc0319e,
+            0x88fcf317f22241e2, 0x441fece3bdf81f03,
+            0xab3c2fddeeaad25a, 0xd527e81cad7626c3,
+            0xd60b3bd56a5586f1, 0x8a71e223d8d3b074,
+            0x85c7056562757456, 0xf6872d5667844e49,
+            0xa738c6bebb12d16c, 0xb428f8ac016561db,
+            0xd106f86e69d785c7, 0xe13336d701beba52,
+            0x82a45b450226b39c, 0xecc0024661173473,
+            0xa34d721642b06084, 0x27f002d7f95d0190,
+            0xcc20ce9bd35c78a5, 0x31ec038df7b441f4,
+            0xff290242c83396ce, 0x7e67047175a15271,
+            0x9f79a169bd203e41, 0x0f0062c6e984d386,
+            0xc75809c42c684dd1, 0x52c07b78a3e60868,
+            0xf92e0c3537826145, 0xa7709a56ccdf8a82,
+            0x9bbcc7a142b17ccb, 0x88a66076400bb691,
+            0xc2abf989935ddbfe, 0x6acff893d00ea435,
+            0xf356f7ebf83552fe, 0x0583f6b8c4124d43,
+            0x98165af37b2153de, 0xc3727a337a8b704a,
+            0xbe1bf1b059e9a8d6, 0x744f18c0592e4c5c,
+            0xeda2ee1c7064130c, 0x1162def06f79df73,
+            0x9485d4d1c63e8be7, 0x8addcb5645ac2ba8,
+            0xb9a74a0637ce2ee1, 0x6d953e2bd7173692,
+            0xe8111c87c5c1ba99, 0xc8fa8db6ccdd0437,
+            0x910ab1d4db9914a0, 0x1d9c9892400a22a2,
+            0xb54d5e4a127f59c8, 0x2503beb6d00cab4b,
+            0xe2a0b5dc971f303a, 0x2e44ae64840fd61d,
+            0x8da471a9de737e24, 0x5ceaecfed289e5d2,
+            0xb10d8e1456105dad, 0x7425a83e872c5f47,
+            0xdd50f1996b947518, 0xd12f124e28f77719,
+            0x8a5296ffe33cc92f, 0x82bd6b70d99aaa6f,
+            0xace73cbfdc0bfb7b, 0x636cc64d1001550b,
+            0xd8210befd30efa5a, 0x3c47f7e05401aa4e,
+            0x8714a775e3e95c78, 0x65acfaec34810a71,
+            0xa8d9d1535ce3b396, 0x7f1839a741a14d0d,
+            0xd31045a8341ca07c, 0x1ede48111209a050,
+            0x83ea2b892091e44d, 0x934aed0aab460432,
+            0xa4e4b66b68b65d60, 0xf81da84d5617853f,
+            0xce1de40642e3f4b9, 0x36251260ab9d668e,
+            0x80d2ae83e9ce78f3, 0xc1d72b7c6b426019,
+            0xa1075a24e4421730, 0xb24cf65b8612f81f,
+            0xc94930ae1d529cfc, 0xdee033f26797b627,
+            0xfb9b7cd9a4a7443c, 0x169840ef017da3b1,
+            0x9d412e0806e88aa5, 0x8e1f289560ee864e,
+            0xc491798a08a2ad4e, 0xf1a6f2bab92a27e2,
+            0xf5b5d7ec8acb58a2, 0xae10af696774b1db,
+            0x9991a6f3d6bf1765, 0xacca6da1e0a8ef29,
+            0xbff610b0cc6edd3f, 0x17fd090a58d32af3,
+            0xeff394dcff8a948e, 0xddfc4b4cef07f5b0,
+            0x95f83d0a1fb69cd9, 0x4abdaf101564f98e,
+            0xbb764c4ca7a4440f, 0x9d6d1ad41abe37f1,
+            0xea53df5fd18d5513, 0x84c86189216dc5ed,
+            0x92746b9be2f8552c, 0x32fd3cf5b4e49bb4,
+            0xb7118682dbb66a77, 0x3fbc8c33221dc2a1,
+            0xe4d5e82392a40515, 0x0fabaf3feaa5334a,
+            0x8f05b1163ba6832d, 0x29cb4d87f2a7400e,
+            0xb2c71d5bca9023f8, 0x743e20e9ef511012,
+            0xdf78e4b2bd342cf6, 0x914da9246b255416,
+            0x8bab8eefb6409c1a, 0x1ad089b6c2f7548e,
+            0xae9672aba3d0c320, 0xa184ac2473b529b1,
+            0xda3c0f568cc4f3e8, 0xc9e5d72d90a2741e,
+            0x8865899617fb1871, 0x7e2fa67c7a658892,
+            0xaa7eebfb9df9de8d, 0xddbb901b98feeab7,
+            0xd51ea6fa85785631, 0x552a74227f3ea565,
+            0x8533285c936b35de, 0xd53a88958f87275f,
+            0xa67ff273b8460356, 0x8a892abaf368f137,
+            0xd01fef10a657842c, 0x2d2b7569b0432d85,
+            0x8213f56a67f6b29b, 0x9c3b29620e29fc73,
+            0xa298f2c501f45f42, 0x8349f3ba91b47b8f,
+            0xcb3f2f7642717713, 0x241c70a936219a73,
+            0xfe0efb53d30dd4d7, 0xed238cd383aa0110,
+            0x9ec95d1463e8a506, 0xf4363804324a40aa,
+            0xc67bb4597ce2ce48, 0xb143c6053edcd0d5,
+            0xf81aa16fdc1b81da, 0xdd94b7868e94050a,
+            0x9b10a4e5e9913128, 0xca7cf2b4191c8326,
+            0xc1d4ce1f63f57d72, 0xfd1c2f611f63a3f0,
+            0xf24a01a73cf2dccf, 0xbc633b39673c8cec,
+            0x976e41088617ca01, 0xd5be0503e085d813,
+            0xbd49d14aa79dbc82, 0x4b2d8644d8a74e18,
+            0xec9c459d51852ba2, 0xddf8e7d60ed1219e,
+            0x93e1ab8252f33b45, 0xcabb90e5c942b503,
+            0xb8da1662e7b00a17, 0x3d6a751f3b936243,
+            0xe7109bfba19c0c9d, 0x0cc512670a783ad4,
+            0x906a617d450187e2, 0x27fb2b80668b24c5,
+            0xb484f9dc9641e9da, 0xb1f9f660802dedf6,
+            0xe1a63853bbd26451, 0x5e7873f8a0396973,
+            0x8d07e33455637eb2, 0xdb0b487b6423e1e8,
+            0xb049dc016abc5e5f, 0x91ce1a9a3d2cda62,
+            0xdc5c5301c56b75f7, 0x7641a140cc7810fb,
+            0x89b9b3e11b6329ba, 0xa9e904c87fcb0a9d,
+            0xac2820d9623bf429, 0x546345fa9fbdcd44,
+            0xd732290fbacaf133, 0xa97c177947ad4095,
+            0x867f59a9d4bed6c0, 0x49ed8eabcccc485d,
+            0xa81f301449ee8c70, 0x5c68f256bfff5a74,
+            0xd226fc195c6a2f8c, 0x73832eec6fff3111,
+            0x83585d8fd9c25db7, 0xc831fd53c5ff7eab,
+            0xa42e74f3d032f525, 0xba3e7ca8b77f5e55,
+            0xcd3a1230c43fb26f, 0x28ce1bd2e55f35eb,
+            0x80444b5e7aa7cf85, 0x7980d163cf5b81b3,
+            0xa0555e361951c366, 0xd7e105bcc332621f,
+            0xc86ab5c39fa63440, 0x8dd9472bf3fefaa7,
+            0xfa856334878fc150, 0xb14f98f6f0feb951,
+            0x9c935e00d4b9d8d2, 0x6ed1bf9a569f33d3,
+            0xc3b8358109e84f07, 0x0a862f80ec4700c8,
+            0xf4a642e14c6262c8, 0xcd27bb612758c0fa,
+            0x98e7e9cccfbd7dbd, 0x8038d51cb897789c,
+            0xbf21e44003acdd2c, 0xe0470a63e6bd56c3,
+            0xeeea5d5004981478, 0x1858ccfce06cac74,
+            0x95527a5202df0ccb, 0x0f37801e0c43ebc8,
+            0xbaa718e68396cffd, 0xd30560258f54e6ba,
+            0xe950df20247c83fd, 0x47c6b82ef32a2069,
+            0x91d28b7416cdd27e, 0x4cdc331d57fa5441,
+            0xb6472e511c81471d, 0xe0133fe4adf8e952,
+            0xe3d8f9e563a198e5, 0x58180fddd97723a6,
+            0x8e679c2f5e44ff8f, 0x570f09eaa7ea7648
+        };
+
+        struct UInt128 {
+            std::uint64_t low;
+            std::uint64_t high;
+        };
+
+        static UInt128 multiply(std::uint64_t a, std::uint64_t b)
+        {
+            UInt128 result;
+#if defined(__SIZEOF_INT128__)
+            __extension__ typedef unsigned __int128 uint128;
+            const uint128 product = static_cast<uint128>(a) * b;
+            result.low = static_cast<std::uint64_t>(product);
+            result.high = static_cast<std::uint64_t>(product >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+            result.low = _umul128(a, b, &result.high);
+#else
+            const std::uint64_t aLow = a & 0xFFFFFFFF, aHigh = a >> 32;
+            const std::uint64_t bLow = b & 0xFFFFFFFF, bHigh = b >> 32;
+            const std::uint64_t lowLow = aLow * bLow;
+            const std::uint64_t highLow = aHigh * bLow + (lowLow >> 32);
+            const std::uint64_t lowHigh = aLow * bHigh + (highLow & 0xFFFFFFFF);
+            result.low = (lowHigh << 32) | (lowLow & 0xFFFFFFFF);
+            result.high = aHigh * bHigh + (highLow >> 32) + (lowHigh >> 32);
+#endif
+            return result;
+        }
+
+        static int leadingZeros(std::uint64_t bits)
+        {
+#if defined(_MSC_VER) && defined(_M_X64)
+            unsigned long index;
+            _BitScanReverse64(&index, bits);
+            return 63 - static_cast<int>(index);
+#elif defined(_MSC_VER)
+            unsigned long index;
+            if (_BitScanReverse(&index, static_cast<unsigned long>(bits >> 32))) {
+                return 31 - static_cast<int>(index);
+            }
+            _BitScanReverse(&index, static_cast<unsigned long>(bits));
+            return 63 - static_cast<int>(index);
+#else
+            return __builtin_clzll(bits);
+#endif
+        }
+
+        static constexpr int MANTISSA_BITS = 52;
+        static constexpr int MINIMUM_EXPONENT = -1023;
+        static constexpr int INFINITE_POWER = 0x7FF;
+
+        /**
+         * Eisel-Lemire: converts w * 10^q (w != 0) to the closest double by multiplying w with a
+         * 128 bit approximation of 5^q. Returns the biased binary exponent and writes the mantissa bits,
+         * or returns -1 if the result could not be determined.
+         */
+        static int eiselLemire(std::int64_t q, std::uint64_t w, std::uint64_t& mantissa)
+        {
+            if (q < SMALLEST_POWER_OF_TEN) {
+                mantissa = 0;
+                return 0;
+            }
+            if (q > LARGEST_POWER_OF_TEN) {
+                mantissa = 0;
+                return INFINITE_POWER;
+            }
+
+            const int lz = leadingZeros(w);
+            w <<= lz;
+
+            // the first product is exact enough unless all of the bits below the ones we keep are set
+            const size_t index = 2 * static_cast<size_t>(q - SMALLEST_POWER_OF_TEN);
+            UInt128 product = multiply(w, POWERS_OF_FIVE[index]);
+            const std::uint64_t precisionMask = 0xFFFFFFFFFFFFFFFF >> (MANTISSA_BITS + 3);
+            if ((product.high & precisionMask) == precisionMask) {
+                const UInt128 second = multiply(w, POWERS_OF_FIVE[index + 1]);
+                product.low += second.high;
+                if (second.high > product.low) {
+                    ++product.high;
+                }
+            }
+
+            const int upperBit = static_cast<int>(product.high >> 63);
+            const int shift = upperBit + 64 - MANTISSA_BITS - 3;
+            mantissa = product.high >> shift;
+            // floor(log2(10^q)) + 63, computed without floating point
+            const int power = static_cast<int>(((152170 + 65536) * q) >> 16) + 63;
+            int power2 = power + upperBit - lz - MINIMUM_EXPONENT;
+
+            if (power2 <= 0) { // subnormal
+                if (-power2 + 1 >= 64) {
+                    mantissa = 0;
+                    return 0;
+                }
+                mantissa >>= -power2 + 1;
+                mantissa += (mantissa & 1);
+                mantissa >>= 1;
+                return mantissa < (static_cast<std::uint64_t>(1) << MANTISSA_BITS) ? 0 : 1;
+            }
+
+            // exactly halfway between two doubles, round to even
+            if (product.low <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1) {
+                if ((mantissa << shift) == product.high) {
+                    mantissa &= ~static_cast<std::uint64_t>(1);
+                }
+            }
+
+            mantissa += (mantissa & 1);
+            mantissa >>= 1;
+            if (mantissa >= (static_cast<std::uint64_t>(2) << MANTISSA_BITS)) {
+                mantissa = static_cast<std::uint64_t>(1) << MANTISSA_BITS;
+                ++power2;
+            }
+            mantissa &= ~(static_cast<std::uint64_t>(1) << MANTISSA_BITS);
+            if (power2 >= INFINITE_POWER) {
+                mantissa = 0;
+                return INFINITE_POWER;
+            }
+            return power2;
+        }
+
+        static double assembleDouble(bool negative, int power2, std::uint64_t mantissa)
+        {
+            const std::uint64_t bits = mantissa
+                | (static_cast<std::uint64_t>(power2) << MANTISSA_BITS)
+                | (static_cast<std::uint64_t>(negative ? 1 : 0) << 63);
+            double value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        static const double EXACT_POWERS_OF_TEN[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+
+        // Only used when the number has more than 19 significant digits and
+        // its leading digits are too close to the halfway point between two doubles.
+        static double slowToDouble(StringView text)
+        {
+            std::istringstream stream(text.str());
+            stream.imbue(std::locale::classic());
+            double value = 0.0;
+            stream >> value;
+            return value;
+        }
+
+        /**
+         * Stores an integral number exactly if it fits into 64 bits. Returns false if it does not, or if it is a negative zero
+         * which only a double can hold.
+         */
+        static bool toInteger(const DecimalNumber& number, const char* first, const char* last, NumberLiteral& result)
+        {
+            std::uint64_t magnitude = number.mantissa;
+            if (number.truncated) {
+                // redo the digits with overflow checks since only the first 19 made it into the mantissa
+                magnitude = 0;
+                for (const char* it = first; it != last; ++it) {
+                    if (!isDigit(*it)) {
+                        continue; // the sign
+                    }
+                    const auto digit = static_cast<std::uint64_t>(*it - '0');
+                    if (magnitude > (std::numeric_limits<std::uint64_t>::max() - digit) / 10) {
+                        return false;
+                    }
+                    magnitude = magnitude * 10 + digit;
+                }
+            }
+
+            constexpr auto maxInt64 = static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max());
+            if (number.negative) {
+                if (magnitude == 0 || magnitude > maxInt64 + 1) {
+                    return false;
+                }
+                result.kind = NumberLiteral::Kind::INT64;
+                result.int64 = static_cast<std::int64_t>(0 - magnitude);
+            } else if (magnitude <= maxInt64) {
+                result.kind = NumberLiteral::Kind::INT64;
+                result.int64 = static_cast<std::int64_t>(magnitude);
+            } else {
+                result.kind = NumberLiteral::Kind::UINT64;
+                result.uint64 = magnitude;
+            }
+            return true;
+        }
+
+        static double toDouble(const DecimalNumber& number, StringView text)
+        {
+            if (number.mantissa == 0) {
+                return number.negative ? -0.0 : 0.0;
+            }
+
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+            // Clinger's fast path: both operands are exact doubles so the single rounding is correct
+            if (!number.truncated && number.mantissa <= (static_cast<std::uint64_t>(1) << 53)
+                && number.exponent >= -22 && number.exponent <= 22) {
+                double value = static_cast<double>(number.mantissa);
+                if (number.exponent < 0) {
+                    value /= EXACT_POWERS_OF_TEN[-number.exponent];
+                } else {
+                    value *= EXACT_POWERS_OF_TEN[number.exponent];
+                }
+                return number.negative ? -value : value;
+            }
+#endif
+
+            std::uint64_t mantissa = 0;
+            const int power2 = eiselLemire(number.exponent, number.mantissa, mantissa);
+            if (number.truncated) {
+                // the true value lies between mantissa and mantissa + 1, if both round the same way we are done
+                std::uint64_t upperMantissa = 0;
+                const int upperPower2 = eiselLemire(number.exponent, number.mantissa + 1, upperMantissa);
+                if (power2 != upperPower2 || mantissa != upperMantissa) {
+                    return slowToDouble(text);
+                }
+            }
+            return assembleDouble(number.negative, power2, mantissa);
+        }
+
+        // Decodes a number that scanNumber found in [first, last)
+        static NumberLiteral decodeNumber(const DecimalNumber& number, const char* first, const char* last)
+        {
+            NumberLiteral result;
+            if (!number.integral || !toInteger(number, first, last, result)) {
+                result.kind = NumberLiteral::Kind::DOUBLE;
+                result.real = toDouble(number, StringView(first, last - first));
+            }
+            return result;
+        }
+
+        static Number toNumber(const NumberLiteral& literal)
+        {
+            switch (literal.kind) {
+            case NumberLiteral::Kind::INT64:
+                return Number(literal.int64);
+            case NumberLiteral::Kind::UINT64:
+                return Number(literal.uint64);
+            default:
+                return Number(literal.real);
+            }
+        }
+
+        StructuralIndex::StructuralIndex(StringView text)
+        {
+            _positions.reserve(text.size() / 8);
+
+            std::uint64_t prevEscaped = 0;
+            std::uint64_t prevInString = 0;
+            std::uint64_t prevScalar = 0;
+            char padded[BLOCK_SIZE];
+
+            for (size_t offset = 0; offset < text.size(); offset += BLOCK_SIZE) {
+                const char* block = text.data() + offset;
+                if (text.size() - offset < BLOCK_SIZE) {
+                    // pad the last partial block with whitespace, which never produces a structural
+                    std::memset(padded, ' ', BLOCK_SIZE);
+                    std::memcpy(padded, block, text.size() - offset);
+                    block = padded;
+                }
+
+                const BlockMasks masks = classifyBlock(block);
+                const std::uint64_t escaped = findEscaped(masks.backslash, prevEscaped);
+                const std::uint64_t quotes = masks.quote & ~escaped;
+                const std::uint64_t inString = prefixXor(quotes) ^ prevInString;
+                prevInString = (inString >> 63) ? ~static_cast<std::uint64_t>(0) : 0;
+
+                // scalars are the bytes of numbers, literals and invalid tokens; only the first byte of each run matters
+                const std::uint64_t scalar = ~(masks.op | masks.whitespace | quotes | inString);
+                const std::uint64_t scalarStart = scalar & ~((scalar << 1) | prevScalar);
+                prevScalar = scalar >> 63;
+
+                std::uint64_t structurals = (masks.op & ~inString) | quotes | scalarStart;
+                while (structurals) {
+                    _positions.push_back(static_cast<std::uint32_t>(offset + trailingZeros(structurals)));
+                    structurals &= structurals - 1;
+                }
+            }
+        }
+
+        const std::vector<std::uint32_t>& StructuralIndex::getPositions() const
+        {
+            return _positions;
+        }
+
+        Token::Token(TokenType type, StringView value, size_t offset)
+            : type(type), value(value), offset(offset), unescaped(false) {}
+        
+        Lexer::Lexer(StringView text, const StructuralIndex* index)
+            : _cursor(0), _text(text), _index(index), _structural(0) {}
+
+        TextPosition getTextPosition(StringView text, size_t offset)
+        {
+            const char* it = text.data();
+            const char* last = text.data() + std::min(offset, text.size());
+            const char* lineStart = it;
+            int line = 1;
+            while ((it = static_cast<const char*>(std::memchr(it, '\n', last - it))) != nullptr) {
+                ++line;
+                lineStart = ++it;
+            }
+            return { line, static_cast<int>(last - lineStart) + 1 };
+        }
+
+        std::string ParseFailure::getMessage(StringView text) const
+        {
+            const auto position = getTextPosition(text, offset);
+            switch (code) {
+            case ParseErrorCode::NONE:
+                return std::string();
+            case ParseErrorCode::UNEXPECTED_CHARACTER:
+                return format("Expecting '%s' at line %d:%d but found '%c' instead!", expected, position.line, position.pos, found);
+            case ParseErrorCode::DANGLING_ESCAPE:
+                return format("Dangling control '\\' found at line %d:%d!", position.line, position.pos);
+            case ParseErrorCode::INVALID_UNICODE_ESCAPE:
+                return format("Only 4 hexadecimal values accepted at line %d:%d", position.line, position.pos);
+            case ParseErrorCode::INVALID_TOKEN:
+                return format("'%c' is not a valid token at line %d:%d!", found, position.line, position.pos);
+            case ParseErrorCode::UNEXPECTED_TOKEN:
+                return format("Expecting '%s' at line %d:%d but got '%s' instead!", expected, position.line, position.pos,
+                    (tokenUnescaped ? unescapedToken : token.str()).c_str());
+            case ParseErrorCode::TOO_DEEP:
+                return format("The document is nested deeper than %d levels at line %d:%d!",
+                    static_cast<int>(std::min<size_t>(maxDepth, std::numeric_limits<int>::max())), position.line, position.pos);
+            case ParseErrorCode::TOO_LARGE:
+                return "The key is too long to be interned.";
+            case ParseErrorCode::OUT_OF_MEMORY:
+                return "Not enough memory to parse the document!";
+            case ParseErrorCode::INTERNAL_ERROR:
+                return "The document could not be parsed because of an unexpected exception!";
+            }
+            return std::string();
+        }
+
+        TextPosition Lexer::getPosition(size_t offset) const
+        {
+            return getTextPosition(_text, offset);
+        }
+
+        const ParseFailure& Lexer::getFailure() const
+        {
+            return _failure;
+        }
+
+        void Lexer::jumpTo(size_t offset)
+        {
+            _cursor = offset;
+        }
+
+        void Lexer::skipToStructural()
+        {
+            const auto& positions = _index->getPositions();
+            while (_structural < positions.size() && positions[_structural] < _cursor) {
+                ++_structural;
+            }
+
+            // only whitespace can sit between the end of the last token and the next structural. Anything
+            // else is left for the regular lexing to report.
+            if (_structural < positions.size() && positions[_structural] > _cursor && std::isspace(static_cast<unsigned char>(curr()))) {
+                jumpTo(positions[_structural]);
+            }
+        }
+
+        bool Lexer::lexIndexedString(StringView& str)
+        {
+            // the closing quote is the structural right after the opening one
+            const auto& positions = _index->getPositions();
+            if (_structural + 1 >= positions.size() || positions[_structural] != _cursor) {
+                return false;
+            }
+            const size_t closingQuote = positions[_structural + 1];
+            if (_text[closingQuote] != '\"') {
+                return false;
+            }
+
+            const char* first = _text.data() + _cursor + 1;
+            const size_t length = closingQuote - _cursor - 1;
+            if (std::memchr(first, '\\', length) != nullptr) {
+                return false; // escapes go through the regular lexing
+            }
+
+            str = StringView(first, length);
+            jumpTo(closingQuote + 1);
+            _structural += 2;
+            return true;
+        }
+
+        bool Lexer::isDoneReading() const
+        {
+            return _cursor >= _text.size();
+        }
+
+        Token Lexer::fail(ParseErrorCode code, const char* expected)
+        {
+            _failure.code = code;
+            _failure.offset = _cursor;
+            _failure.expected = expected;
+            _failure.found = curr();
+            return { TokenType::INVALID, StringView(), _cursor };
+        }
+
+        bool Lexer::failed() const
+        {
+            return _failure.code != ParseErrorCode::NONE;
+        }
+
+        Token Lexer::lexNumber()
+        {
+            const size_t start = _cursor;
+            const char* first = _text.data() + _cursor;
+
+            DecimalNumber number;
+            const char* last = scanNumber(first, _text.end(), number);
+            _cursor += last - first;
+            if (!number.valid) {
+                return fail(ParseErrorCode::UNEXPECTED_CHARACTER, "digit");
+            }
+
+            Token token(TokenType::NUMBER, StringView(first, last - first), start);
+            token.number = decodeNumber(number, first, last);
+            return token;
+        }
+
+        StringView Lexer::lexValueSequence(StringView expected, const char* description)
+        {
+            const char* first = _text.data() + _cursor;
+            char c = curr();
+            for (size_t i = 0; i < expected.size() && !isDoneReading(); ++i) {
+                if (c != expected[i]) {
+                    fail(ParseErrorCode::UNEXPECTED_CHARACTER, description);
+                    return StringView();
+                }
+                c = next();
+            }
+            return StringView(first, _text.data() + _cursor - first);
+        }
+
+        Token Lexer::lexBool(StringView expected)
+        {
+            const size_t start = _cursor;
+            auto value = lexValueSequence(expected, expected[0] == 't' ? "value sequence true" : "value sequence false");
+            if (failed()) {
+                return { TokenType::INVALID, StringView(), _failure.offset };
+            }
+            return { TokenType::JBOOL, value, start };
+        }
+
+        Token Lexer::lexNull()
+        {
+            const size_t start = _cursor;
+            auto value = lexValueSequence("null", "value sequence null");
+            if (failed()) {
+                return { TokenType::INVALID, StringView(), _failure.offset };
+            }
+            return { TokenType::JNULL, value, start };
+        }
+
+        bool Lexer::isWhitespaceControlChar(char n) const
+        {
+            return n == 'b' || n == 'f' || n == 'n' || n == 'r' || n == 't';
+        }
+
+        bool Lexer::isControlChar(char c) const
+        {
+            return c == '\"' || c == '\\' || c == '/' || isWhitespaceControlChar(c) || c == 'u';
+        }
+
+        char Lexer::getControlChar()
+        {
+            char n = peek();
+            if (n == EOF) {
+                fail(ParseErrorCode::DANGLING_ESCAPE);
+                return EOF;
+            }
+            next(); // eat the control character
+
+            if (isControlChar(n)) {
+                return n;
+            }
+            fail(ParseErrorCode::UNEXPECTED_CHARACTER, R"(("|\|/|b|f|n|r|t) control character)");
+            return EOF;
+        }
+
+        bool Lexer::isHexChar(char c)
+        {
+            const auto lower = std::tolower(c);
+            return std::isdigit(c) || (lower >= 'a' && lower <= 'f');
+        }
+
+        StringView Lexer::getHexDigits()
+        {
+            const char* first = _text.data() + _cursor;
+            size_t length = 0;
+            for (char c = curr(); !isDoneReading(); c = next()) {
+                if (isHexChar(c)) {
+                    ++length;
+                } else {
+                    --_cursor; // leave the lexer at the last valid character
+                    break;
+                }
+            }
+            
+            if (length != 4) {
+                fail(ParseErrorCode::INVALID_UNICODE_ESCAPE);
+                return StringView();
+            }
+
+            return StringView(first, length);
+        }
+
+        Token Lexer::lexString()
+        {
+            if (curr() != '\"') {
+                return fail(ParseErrorCode::UNEXPECTED_CHARACTER, "initial \" for string");
+            }
+            const size_t start = _cursor;
+
+            StringView contents;
+            if (_index != nullptr && lexIndexedString(contents)) {
+                return { TokenType::STRING, contents, start };
+            }
+            next(); // eat the quote
+
+            // most strings have no escapes, their contents are taken straight from the text
+            const char* first = _text.data() + _cursor;
+            const char* special = findStringSpecial(first, _text.end());
+            _cursor += special - first;
+            if (!isDoneReading() && curr() == '\"') {
+                next(); // eat the quote
+                return { TokenType::STRING, StringView(first, special - first), start };
+            }
+
+            std::string& str = _unescaped;
+            str.assign(first, special);
+            bool endQuoteFound = false;
+            while (!endQuoteFound && !isDoneReading()) {
+                // copy the run of characters that need no special handling in one go
+                const char* run = _text.data() + _cursor;
+                special = findStringSpecial(run, _text.end());
+                if (special != run) {
+                    str.append(run, special);
+                    _cursor += special - run;
+                    if (isDoneReading()) {
+                        break;
+                    }
+                }
+
+                char c = curr();
+                if (c == '\"') {
+                    endQuoteFound = true;
+                } else if (c == '\\') {
+                    char n = getControlChar();
+                    if (failed()) {
+                        return { TokenType::INVALID, StringView(), _failure.offset };
+                    }
+                    if (n == 'u') {
+                        next(); // eat the 'u'
+                        auto digits = getHexDigits();
+                        if (failed()) {
+                            return { TokenType::INVALID, StringView(), _failure.offset };
+                        }
+                        std::uint32_t codePoint = decodeHex4(digits.data());
+                        std::uint32_t low;
+                        if (isHighSurrogate(codePoint) && readLowSurrogate(_text.data() + _cursor + 1, _text.end(), low)) {
+                            codePoint = combineSurrogates(codePoint, low);
+                            _cursor += 6; // the low half was read as well
+                        }
+                        appendUtf8(str, codePoint);
+                    } else {
+                        str += decodeShortEscape(n);
+                    }
+                } else {
+                    str += c; // control characters are kept as they are
+                }
+                next();
+            }
+
+            if (!endQuoteFound) {
+                return fail(ParseErrorCode::UNEXPECTED_CHARACTER, "Terminating \" for string");
+            }
+            Token token(TokenType::STRING, StringView(str), start);
+            token.unescaped = true;
+            return token;
+        }
+
+        char Lexer::next()
+        {
+            ++_cursor;
+            return curr();
+        }
+
+        char Lexer::curr()
+        {
+            // the text is not guaranteed to be null terminated so never read past its end
+            return isDoneReading() ? '\0' : _text[_cursor];
+        }
+
+        char Lexer::peek()
+        {
+            if (_cursor + 1 >= _text.size()) {
+                return EOF;
+            }
+            return _text[_cursor + 1];
+        }
+
+        void Lexer::skipWhitespace()
+        {
+            while (!isDoneReading() && std::isspace(static_cast<unsigned char>(_text[_cursor]))) {
+                ++_cursor;
+            }
+        }
+
+        Token Lexer::reportToken(TokenType type)
+        {
+            const size_t start = _cursor;
+            next(); // eat the token
+            return { type, StringView(_text.data() + start, 1), start };
+        }
+
+        Token Lexer::getToken()
+        {
+            auto token = readToken();
+            if (token.type == TokenType::INVALID) {
+                throw parse_exception(_failure.getMessage(_text));
+            }
+            return token;
+        }
+
+        Token Lexer::readToken()
+        {
+            if (_index != nullptr) {
+                skipToStructural();
+            }
+            skipWhitespace();
+            if (isDoneReading()) {
+                return { TokenType::NONE, StringView(), _cursor };
+            }
+
+            char c = curr();
+            if (c == '{') {
+                return reportToken(TokenType::LBRACE);
+            } else if (c == '}') {
+                return reportToken(TokenType::RBRACE);
+            } else if (c == '\"') {
+                return lexString();
+            } else if (c == ':') {
+                return reportToken(TokenType::COLON);
+            } else if (c == ',') {
+                return reportToken(TokenType::COMMA);
+            } else if (c == '[') {
+                return reportToken(TokenType::LBRACKET);
+            } else if (c == ']') {
+                return reportToken(TokenType::RBRACKET);
+            } else if (c == 't') {
+                return lexBool("true");
+            } else if (c == 'f') {
+                return lexBool("false");
+            } else if (c == 'n') {
+                return lexNull();
+            } else if (c == '-' || c == '+' || std::isdigit(c)) {
+                return lexNumber();
+            }
+            return fail(ParseErrorCode::INVALID_TOKEN);
+        }
+
+        // A token the lexer could not make sense of already tells what went wrong
+        static void failOnToken(ParseFailure& failure, const Lexer& lexer, const Token& token, const char* expected)
+        {
+            if (token.type == TokenType::INVALID) {
+                failure = lexer.getFailure();
+                return;
+            }
+            failure.code = ParseErrorCode::UNEXPECTED_TOKEN;
+            failure.offset = token.offset;
+            failure.expected = expected;
+            failure.token = token.value;
+            failure.tokenUnescaped = token.unescaped;
+            if (token.unescaped) {
+                failure.unescapedToken = token.value.str();
+            }
+        }
+
+        // Points at the token that opened the container that is one level too deep
+        static void failOnDepth(ParseFailure& failure, const Token& token, size_t maxDepth)
+        {
+            failure.code = ParseErrorCode::TOO_DEEP;
+            failure.offset = token.offset;
+            failure.maxDepth = maxDepth;
+        }
+
+        template <class Derived>
+        const ParseFailure& DocumentWalker<Derived>::getFailure() const
+        {
+            return failure;
+        }
+
+        template <class Derived>
+        void DocumentWalker<Derived>::fail(const char* expected)
+        {
+            failOnToken(failure, lexer, currentToken, expected);
+        }
+
+        template <class Derived>
+        bool DocumentWalker<Derived>::walk()
+        {
+            auto& parser = static_cast<Derived&>(*this);
+            auto startContainer = [&](bool isObject) {
+                if (open.size() >= maxDepth) {
+                    failOnDepth(failure, currentToken, maxDepth);
+                    return false;
+                }
+                parser.startContainer(isObject);
+                open.push_back(isObject);
+                return true;
+            };
+
+            currentToken = lexer.readToken();
+            if (currentToken.type != TokenType::LBRACE) {
+                fail("{");
+                return false;
+            }
+            open.clear();
+            open.reserve(std::min<size_t>(maxDepth, 32));
+            if (!startContainer(true)) {
+                return false;
+            }
+
+            // what the current token has to be
+            enum class Expect { MEMBER_OR_END, MEMBER, VALUE_OR_END, VALUE, SEPARATOR_OR_END } expect = Expect::MEMBER_OR_END;
+            for (;;) {
+                if (expect != Expect::MEMBER && expect != Expect::VALUE) {
+                    currentToken = lexer.readToken();
+                }
+
+                if (expect == Expect::SEPARATOR_OR_END && currentToken.type == TokenType::COMMA) {
+                    currentToken = lexer.readToken(); // eat the comma
+                    expect = open.back() ? Expect::MEMBER : Expect::VALUE;
+                    continue;
+                }
+
+                const bool isObject = open.back();
+                if (expect == Expect::MEMBER_OR_END || expect == Expect::VALUE_OR_END || expect == Expect::SEPARATOR_OR_END) {
+                    if (currentToken.type == (isObject ? TokenType::RBRACE : TokenType::RBRACKET)) {
+                        open.pop_back();
+                        parser.endContainer(isObject, open.empty());
+                        if (open.empty()) {
+                            return true;
+                        }
+                        expect = Expect::SEPARATOR_OR_END;
+                        continue;
+                    }
+                    if (expect == Expect::SEPARATOR_OR_END) {
+                        fail(isObject ? "}" : "]");
+                        return false;
+                    }
+                }
+
+                if (isObject) {
+                    // name
+                    if (currentToken.type != TokenType::STRING) {
+                        fail("<string>");
+                        return false;
+                    }
+                    parser.key();
+
+                    // colon
+                    currentToken = lexer.readToken();
+                    if (currentToken.type != TokenType::COLON) {
+                        fail(":");
+                        return false;
+                    }
+                    currentToken = lexer.readToken(); // eat the colon
+                }
+
+                // value
+                if (currentToken.type == TokenType::LBRACE) {
+                    if (!startContainer(true)) {
+                        return false;
+                    }
+                    expect = Expect::MEMBER_OR_END;
+                } else if (currentToken.type == TokenType::LBRACKET) {
+                    if (!startContainer(false)) {
+                        return false;
+                    }
+                    expect = Expect::VALUE_OR_END;
+                } else {
+                    if (!parser.scalar()) {
+                        return false;
+                    }
+                    expect = Expect::SEPARATOR_OR_END;
+                }
+            }
+        }
+
+        Parser::Parser(Lexer lexer, std::unique_ptr<DocumentResources> resources, size_t maxDepth)
+            : DocumentWalker<Parser>(lexer, maxDepth), document(std::move(resources)), resources(document.get()), arena(nullptr)
+        {
+            if (document != nullptr) {
+                arena = document->arena.get();
+            }
+        }
+
+        Parser::~Parser()
+        {
+            // when parsing fails the open containers go innermost first, the root owns the arena the others live in
+            while (!levels.empty()) {
+                releaseValue(std::move(levels.back().container), arena);
+                levels.pop_back();
+            }
+        }
+
+        template <class T, class... Args>
+        std::unique_ptr<T> Parser::create(Args&&... args)
+        {
+            if (arena != nullptr) {
+                return std::unique_ptr<T>(new (*arena) T(std::forward<Args>(args)...));
+            }
+            return std::make_unique<T>(std::forward<Args>(args)...);
+        }
+
+        std::unique_ptr<Object> Parser::createObject()
+        {
+            // the root is created first and takes ownership of the arena and key table, every other object uses them
+            if (document != nullptr) {
+                return std::make_unique<Object>(std::move(document));
+            }
+            return create<Object>(resources);
+        }
+
+        void Parser::addValue(std::unique_ptr<Value> value)
+        {
+            auto& level = levels.back();
+            if (open.back()) {
+                static_cast<Object*>(level.container.get())->addValue(level.getName(), std::move(value));
+            } else {
+                static_cast<Array*>(level.container.get())->addValue(std::move(value));
+            }
+        }
+
+        void Parser::startContainer(bool isObject)
+        {
+            std::unique_ptr<Value> container;
+            if (isObject) {
+                container = createObject();
+            } else {
+                container = create<Array>(resources);
+            }
+            try {
+                levels.emplace_back();
+            } catch (...) {
+                releaseValue(std::move(container), arena);
+                throw;
+            }
+            auto& level = levels.back();
+            level.container = std::move(container);
+            level.nameUnescaped = false;
+        }
+
+        void Parser::endContainer(bool, bool isRoot)
+        {
+            auto container = std::move(levels.back().container);
+            levels.pop_back();
+            if (isRoot) {
+                root.reset(static_cast<Object*>(container.release()));
+            } else {
+                addValue(std::move(container));
+            }
+        }
+
+        void Parser::key()
+        {
+            auto& level = levels.back();
+            level.nameUnescaped = currentToken.unescaped;
+            if (currentToken.unescaped) {
+                level.unescapedName.assign(currentToken.value.data(), currentToken.value.size());
+            } else {
+                level.name = currentToken.value;
+            }
+        }
+
+        bool Parser::scalar()
+        {
+            std::unique_ptr<Value> value;
+            if (currentToken.type == TokenType::STRING) {
+                if (arena != nullptr) {
+                    value = create<json::String>(currentToken.value, *arena);
+                } else {
+                    value = std::make_unique<json::String>(currentToken.value.str());
+                }
+            } else if (currentToken.type == TokenType::JBOOL) {
+                value = create<json::Bool>(currentToken.value[0] == 't');
+            } else if (currentToken.type == TokenType::JNULL) {
+                value = create<json::Null>();
+            } else if (currentToken.type == TokenType::NUMBER) {
+                value = create<json::Number>(toNumber(currentToken.number));
+            } else {
+                fail("<value>");
+                return false;
+            }
+            addValue(std::move(value));
+            return true;
+        }
+
+        std::unique_ptr<Object> Parser::parse()
+        {
+            levels.clear();
+            levels.reserve(std::min<size_t>(maxDepth, 32));
+            if (!walk()) {
+                return nullptr;
+            }
+            return std::move(root);
+        }
+
+        EventParser::EventParser(Lexer lexer, ParseHandler* handler, size_t maxDepth)
+            : DocumentWalker<EventParser>(lexer, maxDepth), handler(handler) {}
+
+        void EventParser::startContainer(bool isObject)
+        {
+            if (isObject) {
+                handler->startObject();
+            } else {
+                handler->startArray();
+            }
+        }
+
+        void EventParser::endContainer(bool isObject, bool)
+        {
+            if (isObject) {
+                handler->endObject();
+            } else {
+                handler->endArray();
+            }
+        }
+
+        void EventParser::key()
+        {
+            handler->key(currentToken.value);
+        }
+
+        bool EventParser::scalar()
+        {
+            if (currentToken.type == TokenType::STRING) {
+                handler->string(currentToken.value);
+            } else if (currentToken.type == TokenType::JBOOL) {
+                handler->boolean(currentToken.value[0] == 't');
+            } else if (currentToken.type == TokenType::JNULL) {
+                handler->null();
+            } else if (currentToken.type == TokenType::NUMBER) {
+                handler->number(toNumber(currentToken.number));
+            } else {
+                fail("<value>");
+                return false;
+            }
+            return true;
+        }
+
+        bool EventParser::parse()
+        {
+            return walk();
+        }
+    }
+
+    void DocumentBuilder::addValue(std::unique_ptr<Value> value)
+    {
+        if (_levels.empty()) {
+            // the parsers only ever report an object at the root
+            _document.reset(static_cast<Object*>(value.release()));
+            return;
+        }
+
+        auto& level = _levels.back();
+        if (level.container->isObject()) {
+            static_cast<Object*>(level.container.get())->addValue(level.key, std::move(value));
+        } else {
+            static_cast<Array*>(level.container.get())->addValue(std::move(value));
+        }
+    }
+
+    void DocumentBuilder::startObject()
+    {
+        _levels.push_back({ std::make_unique<Object>(), std::string() });
+    }
+
+    void DocumentBuilder::key(StringView name)
+    {
+        _levels.back().key.assign(name.data(), name.size());
+    }
+
+    void DocumentBuilder::endObject()
+    {
+        auto obj = std::move(_levels.back().container);
+        _levels.pop_back();
+        addValue(std::move(obj));
+    }
+
+    void DocumentBuilder::startArray()
+    {
+        _levels.push_back({ std::make_unique<Array>(), std::string() });
+    }
+
+    void DocumentBuilder::endArray()
+    {
+        endObject(); // closing either container works the same way
+    }
+
+    void DocumentBuilder::string(StringView value)
+    {
+        addValue(std::make_unique<String>(value.str()));
+    }
+
+    void DocumentBuilder::number(const Number& value)
+    {
+        addValue(std::make_unique<Number>(value));
+    }
+
+    void DocumentBuilder::boolean(bool value)
+    {
+        addValue(std::make_unique<Bool>(value));
+    }
+
+    void DocumentBuilder::null()
+    {
+        addValue(std::make_unique<Null>());
+    }
+
+    std::unique_ptr<Object> DocumentBuilder::release()
+    {
+        return std::move(_document);
+    }
+
+    namespace detail {
+
+        const std::uint64_t TAPE_PAYLOAD_MASK = (std::uint64_t(1) << 56) - 1;
+        const std::uint64_t TAPE_SIZE_LIMIT = 0xFFFFFF; // container sizes at or above this are counted when asked for
+        const size_t TAPE_NAME_SCAN_LIMIT = 64; // objects with more names than this look them up in an index rather than by hash
+
+        // Orders the names in the index of large objects by object, so the names of one object are a single range
+        std::uint64_t tapeNameKey(size_t objectStart, std::uint32_t hash)
+        {
+            return (static_cast<std::uint64_t>(objectStart) << 32) | hash;
+        }
+
+        std::uint64_t tapeEntry(TapeType type, std::uint64_t payload)
+        {
+            return (static_cast<std::uint64_t>(type) << 56) | payload;
+        }
+
+        TapeType tapeType(std::uint64_t entry)
+        {
+            return static_cast<TapeType>(entry >> 56);
+        }
+
+        std::uint64_t tapePayload(std::uint64_t entry)
+        {
+            return entry & TAPE_PAYLOAD_MASK;
+        }
+
+        // Returns the index of the entry after the value that starts at index
+        size_t skipValue(const std::vector<std::uint64_t>& tape, size_t index)
+        {
+            switch (tapeType(tape[index])) {
+            case TapeType::OBJECT_START:
+            case TapeType::ARRAY_START:
+                return static_cast<size_t>(tape[index] & 0xFFFFFFFF) + 1;
+            case TapeType::INT64:
+            case TapeType::UINT64:
+            case TapeType::DOUBLE:
+                return index + 2;
+            default:
+                return index + 1;
+            }
+        }
+
+        // Returns the index of the end entry of the container that starts at index
+        size_t containerEnd(const std::vector<std::uint64_t>& tape, size_t index)
+        {
+            return static_cast<size_t>(tape[index] & 0xFFFFFFFF);
+        }
+
+        size_t containerSize(const std::vector<std::uint64_t>& tape, size_t index, size_t entriesPerElement)
+        {
+            auto size = static_cast<size_t>(tapePayload(tape[index]) >> 32);
+            if (size < TAPE_SIZE_LIMIT) {
+                return size;
+            }
+
+            size = 0;
+            auto end = containerEnd(tape, index);
+            for (auto i = index + 1; i < end; ++size) {
+                for (size_t j = 0; j < entriesPerElement; ++j) {
+                    i = skipValue(tape, i);
+                }
+            }
+            return size;
+        }
+
+        StringView tapeString(const std::vector<std::uint64_t>& tape, const std::vector<char>& strings, size_t index)
+        {
+            auto offset = static_cast<size_t>(tapePayload(tape[index]));
+            std::uint32_t size;
+            std::memcpy(&size, strings.data() + offset, sizeof(size));
+            return StringView(strings.data() + offset + sizeof(size), size);
+        }
+
+        Number tapeNumber(const std::vector<std::uint64_t>& tape, size_t index)
+        {
+            auto bits = tape[index + 1];
+            switch (tapeType(tape[index])) {
+            case TapeType::INT64:
+                return Number(static_cast<std::int64_t>(bits));
+            case TapeType::UINT64:
+                return Number(bits);
+            default:
+                double value;
+                std::memcpy(&value, &bits, sizeof(value));
+                return Number(value);
+            }
+        }
+
+        bool isTapeNumber(TapeType type)
+        {
+            return type == TapeType::INT64 || type == TapeType::UINT64 || type == TapeType::DOUBLE;
+        }
+    }
+
+    bool ValueView::isObject() const
+    {
+        return _document != nullptr && detail::tapeType(_document->_tape[_index]) == detail::TapeType::OBJECT_START;
+    }
+
+    bool ValueView::isArray() const
+    {
+        return _document != nullptr && detail::tapeType(_document->_tape[_index]) == detail::TapeType::ARRAY_START;
+    }
+
+    bool ValueView::isString() const
+    {
+        return _document != nullptr && detail::tapeType(_document->_tape[_index]) == detail::TapeType::STRING;
+    }
+
+    bool ValueView::isNumber() const
+    {
+        return _document != nullptr && detail::isTapeNumber(detail::tapeType(_document->_tape[_index]));
+    }
+
+    bool ValueView::isBool() const
+    {
+        if (_document == nullptr) {
+            return false;
+        }
+        auto type = detail::tapeType(_document->_tape[_index]);
+        return type == detail::TapeType::TRUE_VALUE || type == detail::TapeType::FALSE_VALUE;
+    }
+
+    bool ValueView::isNull() const
+    {
+        return _document != nullptr && detail::tapeType(_document->_tape[_index]) == detail::TapeType::NULL_VALUE;
+    }
+
+    bool ValueView::isInteger() const
+    {
+        return isNumber() && detail::tapeNumber(_document->_tape, _index).isInteger();
+    }
+
+    ObjectView ValueView::asObject() const
+    {
+        return isObject() ? ObjectView(_document, _index) : ObjectView();
+    }
+
+    ArrayView ValueView::asArray() const
+    {
+        return isArray() ? ArrayView(_document, _index) : ArrayView();
+    }
+
+    StringView ValueView::asString(StringView defaultValue) const
+    {
+        return isString() ? detail::tapeString(_document->_tape, _document->_strings, _index) : defaultValue;
+    }
+
+    bool ValueView::asBool(bool defaultValue) const
+    {
+        return isBool() ? detail::tapeType(_document->_tape[_index]) == detail::TapeType::TRUE_VALUE : defaultValue;
+    }
+
+    double ValueView::asNumber(double defaultValue) const
+    {
+        return isNumber() ? detail::tapeNumber(_document->_tape, _index).getValue() : defaultValue;
+    }
+
+    std::int64_t ValueView::asInt64(std::int64_t defaultValue) const
+    {
+        return isNumber() ? detail::tapeNumber(_document->_tape, _index).getInt64Value() : defaultValue;
+    }
+
+    std::uint64_t ValueView::asUint64(std::uint64_t defaultValue) const
+    {
+        return isNumber() ? detail::tapeNumber(_document->_tape, _index).getUint64Value() : defaultValue;
+    }
+
+    ObjectView::Member ObjectView::Iterator::operator*() const
+    {
+        return { detail::tapeString(_document->_tape, _document->_strings, _index), ValueView(_document, _index + 1) };
+    }
+
+    ObjectView::Iterator& ObjectView::Iterator::operator++()
+    {
+        _index = detail::skipValue(_document->_tape, _index + 1);
+        return *this;
+    }
+
+    size_t ObjectView::size() const
+    {
+        return _document == nullptr ? 0 : detail::containerSize(_document->_tape, _index, 2);
+    }
+
+    ObjectView::Iterator ObjectView::begin() const
+    {
+        return _document == nullptr ? Iterator(nullptr, 0) : Iterator(_document, _index + 1);
+    }
+
+    ObjectView::Iterator ObjectView::end() const
+    {
+        return _document == nullptr ? Iterator(nullptr, 0) : Iterator(_document, detail::containerEnd(_document->_tape, _index));
+    }
+
+    ValueView ObjectView::getValue(StringView name) const
+    {
+        for (auto member : *this) {
+            if (member.name == name) {
+                return member.value;
+            }
+        }
+
+        // recursively search for the value in the first member that is an object
+        for (auto member : *this) {
+            if (member.value.isObject()) {
+                return member.value.asObject().getValue(name);
+            }
+        }
+        return ValueView();
+    }
+
+    ObjectView ObjectView::getObjectValue(StringView name) const
+    {
+        return getValue(name).asObject();
+    }
+
+    ArrayView ObjectView::getArrayValue(StringView name) const
+    {
+        return getValue(name).asArray();
+    }
+
+    StringView ObjectView::getStringValue(StringView name, StringView defaultValue) const
+    {
+        return getValue(name).asString(defaultValue);
+    }
+
+    bool ObjectView::getBoolValue(StringView name, bool defaultValue) const
+    {
+        return getValue(name).asBool(defaultValue);
+    }
+
+    double ObjectView::getNumberValue(StringView name, double defaultValue) const
+    {
+        return getValue(name).asNumber(defaultValue);
+    }
+
+    std::int64_t ObjectView::getInt64Value(StringView name, std::int64_t defaultValue) const
+    {
+        return getValue(name).asInt64(defaultValue);
+    }
+
+    std::uint64_t ObjectView::getUint64Value(StringView name, std::uint64_t defaultValue) const
+    {
+        return getValue(name).asUint64(defaultValue);
+    }
+
+    ValueView ArrayView::Iterator::operator*() const
+    {
+        return ValueView(_document, _index);
+    }
+
+    ArrayView::Iterator& ArrayView::Iterator::operator++()
+    {
+        _index = detail::skipValue(_document->_tape, _index);
+        return *this;
+    }
+
+    size_t ArrayView::size() const
+    {
+        return _document == nullptr ? 0 : detail::containerSize(_document->_tape, _index, 1);
+    }
+
+    ArrayView::Iterator ArrayView::begin() const
+    {
+        return _document == nullptr ? Iterator(nullptr, 0) : Iterator(_document, _index + 1);
+    }
+
+    ArrayView::Iterator ArrayView::end() const
+    {
+        return _document == nullptr ? Iterator(nullptr, 0) : Iterator(_document, detail::containerEnd(_document->_tape, _index));
+    }
+
+    ValueView ArrayView::getValue(size_t index) const
+    {
+        for (auto value : *this) {
+            if (index-- == 0) {
+                return value;
+            }
+        }
+        return ValueView();
+    }
+
+    ObjectView ArrayView::getObjectValue(size_t index) const
+    {
+        return getValue(index).asObject();
+    }
+
+    ArrayView ArrayView::getArrayValue(size_t index) const
+    {
+        return getValue(index).asArray();
+    }
+
+    StringView ArrayView::getStringValue(size_t index, StringView defaultValue) const
+    {
+        return getValue(index).asString(defaultValue);
+    }
+
+    bool ArrayView::getBoolValue(size_t index, bool defaultValue) const
+    {
+        return getValue(index).asBool(defaultValue);
+    }
+
+    double ArrayView::getNumberValue(size_t index, double defaultValue) const
+    {
+        return getValue(index).asNumber(defaultValue);
+    }
+
+    std::int64_t ArrayView::getInt64Value(size_t index, std::int64_t defaultValue) const
+    {
+        return getValue(index).asInt64(defaultValue);
+    }
+
+    std::uint64_t ArrayView::getUint64Value(size_t index, std::uint64_t defaultValue) const
+    {
+        return getValue(index).asUint64(defaultValue);
+    }
+
+    ObjectView Document::getRoot() const
+    {
+        if (_tape.empty()) {
+            return ObjectView();
+        }
+        return ValueView(this, 0).asObject();
+    }
+
+    size_t Document::getMemoryUsage() const
+    {
+        return _tape.capacity() * sizeof(std::uint64_t) + _strings.capacity();
+    }
+
+    Document parseDocument(StringView text)
+    {
+        TapeBuilder builder;
+        parse(text, &builder);
+        return builder.release();
+    }
+
+    Document parseDocument(StringView text, const ParseOptions& options)
+    {
+        TapeBuilder builder;
+        parse(text, &builder, options);
+        return builder.release();
+    }
+
+    void TapeBuilder::add(detail::TapeType type, std::uint64_t payload)
+    {
+        _document._tape.push_back(detail::tapeEntry(type, payload));
+    }
+
+    void TapeBuilder::addValue()
+    {
+        if (!_open.empty() && detail::tapeType(_document._tape[_open.back().start]) == detail::TapeType::ARRAY_START) {
+            ++_open.back().size;
+        }
+    }
+
+    void TapeBuilder::addString(StringView value)
+    {
+        if (value.size() > std::numeric_limits<std::uint32_t>::max()) {
+            throw parse_exception("The string is too long to be stored in a document!");
+        }
+        auto& strings = _document._strings;
+        add(detail::TapeType::STRING, strings.size());
+
+        auto size = static_cast<std::uint32_t>(value.size());
+        auto offset = strings.size();
+        strings.resize(offset + sizeof(size) + value.size());
+        std::memcpy(&strings[offset], &size, sizeof(size));
+        std::copy(value.begin(), value.end(), strings.begin() + offset + sizeof(size));
+    }
+
+    bool TapeBuilder::skip(bool start, bool end)
+    {
+        if (!_skipping) {
+            return false;
+        }
+        if (start) {
+            ++_skipDepth;
+        } else if (end) {
+            --_skipDepth;
+        }
+        _skipping = _skipDepth != 0;
+        return true;
+    }
+
+    bool TapeBuilder::isDuplicate(StringView name, std::uint32_t hash)
+    {
+        const auto& object = _open.back();
+        auto nameAt = [this](size_t index) { return detail::tapeString(_document._tape, _document._strings, index); };
+        if (_names.size() - object.firstName <= detail::TAPE_NAME_SCAN_LIMIT) {
+            for (size_t i = object.firstName; i < _names.size(); ++i) {
+                if (_names[i].hash == hash && nameAt(_names[i].index) == name) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        auto range = _nameIndex.equal_range(detail::tapeNameKey(object.start, hash));
+        for (auto it = range.first; it != range.second; ++it) {
+            if (nameAt(it->second) == name) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void TapeBuilder::addName()
+    {
+        const auto& object = _open.back();
+        const size_t count = _names.size() - object.firstName;
+        if (count <= detail::TAPE_NAME_SCAN_LIMIT) {
+            return;
+        }
+        // the object just outgrew scanning, or already has an index
+        for (size_t i = count == detail::TAPE_NAME_SCAN_LIMIT + 1 ? object.firstName : _names.size() - 1; i < _names.size(); ++i) {
+            _nameIndex.emplace(detail::tapeNameKey(object.start, _names[i].hash), _names[i].index);
+        }
+    }
+
+    void TapeBuilder::startContainer(detail::TapeType type)
+    {
+        addValue();
+        _open.push_back({ _document._tape.size(), 0, _names.size() });
+        add(type); // patched with the index of the end entry once the container is closed
+    }
+
+    void TapeBuilder::endContainer(detail::TapeType start, detail::TapeType end)
+    {
+        auto container = _open.back();
+        _open.pop_back();
+        if (_names.size() - container.firstName > detail::TAPE_NAME_SCAN_LIMIT) {
+            _nameIndex.erase(_nameIndex.lower_bound(detail::tapeNameKey(container.start, 0)),
+                _nameIndex.lower_bound(detail::tapeNameKey(container.start + 1, 0)));
+        }
+        _names.resize(container.firstName);
+
+        auto endIndex = _document._tape.size();
+        if (endIndex > std::numeric_limits<std::uint32_t>::max()) {
+            throw parse_exception("The document is too large to be stored as a tape!");
+        }
+        auto size = std::min<std::uint64_t>(container.size, detail::TAPE_SIZE_LIMIT);
+        _document._tape[container.start] = detail::tapeEntry(start, (size << 32) | endIndex);
+        add(end, container.start);
+        _complete = _open.empty();
+    }
+
+    void TapeBuilder::startObject()
+    {
+        if (!skip(true, false)) {
+            startContainer(detail::TapeType::OBJECT_START);
+        }
+    }
+
+    void TapeBuilder::key(StringView name)
+    {
+        if (_skipping) {
+            return;
+        }
+        const auto hash = detail::hashKey(name);
+        if (isDuplicate(name, hash)) {
+            _skipping = true;
+            _skipDepth = 0;
+            return;
+        }
+        ++_open.back().size;
+        _names.push_back({ _document._tape.size(), hash });
+        addString(name);
+        addName();
+    }
+
+    void TapeBuilder::endObject()
+    {
+        if (!skip(false, true)) {
+            endContainer(detail::TapeType::OBJECT_START, detail::TapeType::OBJECT_END);
+        }
+    }
+
+    void TapeBuilder::startArray()
+    {
+        if (!skip(true, false)) {
+            startContainer(detail::TapeType::ARRAY_START);
+        }
+    }
+
+    void TapeBuilder::endArray()
+    {
+        if (!skip(false, true)) {
+            endContainer(detail::TapeType::ARRAY_START, detail::TapeType::ARRAY_END);
+        }
+    }
+
+    void TapeBuilder::string(StringView value)
+    {
+        if (skip(false, false)) {
+            return;
+        }
+        addValue();
+        addString(value);
+    }
+
+    void TapeBuilder::number(const Number& value)
+    {
+        if (skip(false, false)) {
+            return;
+        }
+        addValue();
+        std::uint64_t bits;
+        if (value.isInt64()) {
+            add(detail::TapeType::INT64);
+            bits = static_cast<std::uint64_t>(value.getInt64Value());
+        } else if (value.isUint64()) {
+            add(detail::TapeType::UINT64);
+            bits = value.getUint64Value();
+        } else {
+            add(detail::TapeType::DOUBLE);
+            auto d = value.getValue();
+            std::memcpy(&bits, &d, sizeof(bits));
+        }
+        _document._tape.push_back(bits);
+    }
+
+    void TapeBuilder::boolean(bool value)
+    {
+        if (skip(false, false)) {
+            return;
+        }
+        addValue();
+        add(value ? detail::TapeType::TRUE_VALUE : detail::TapeType::FALSE_VALUE);
+    }
+
+    void TapeBuilder::null()
+    {
+        if (skip(false, false)) {
+            return;
+        }
+        addValue();
+        add(detail::TapeType::NULL_VALUE);
+    }
+
+    Document TapeBuilder::release()
+    {
+        if (!_complete) {
+            throw parse_exception("The document is incomplete!");
+        }
+        _complete = false;
+        // the document is read only from here on so drop the room left for growth
+        _document._tape.shrink_to_fit();
+        _document._strings.shrink_to_fit();
+        auto document = std::move(_document);
+        _document = Document();
+        return document;
+    }
+
+    namespace detail {
+
+        // The index the children of objects are matched with, which no array index may be
+        const size_t PATH_NO_INDEX = static_cast<size_t>(-1);
+
+        // Turns a path expression into steps, one character at a time
+        class PathCompiler {
+        public:
+            PathCompiler(StringView expression) : _text(expression), _cursor(0) {}
+
+            std::vector<PathStep> compile()
+            {
+                skipWhitespace();
+                expect('$');
+                std::vector<PathStep> steps;
+                while (!isDone()) {
+                    if (curr() == '.') {
+                        ++_cursor;
+                        if (!isDone() && curr() == '.') {
+                            ++_cursor;
+                            steps.push_back(step(PathStep::Kind::DESCENDANT));
+                            if (!isDone() && curr() == '[') {
+                                steps.push_back(bracket());
+                                continue;
+                            }
+                        }
+                        steps.push_back(dotted());
+                    } else if (curr() == '[') {
+                        steps.push_back(bracket());
+                    } else if (isWhitespace(curr())) {
+                        skipWhitespace();
+                        if (!isDone()) {
+                            raiseError("end of path");
+                        }
+                    } else {
+                        raiseError(". or [");
+                    }
+                }
+                return steps;
+            }
+        private:
+            StringView _text;
+            size_t _cursor;
+
+            static PathStep step(PathStep::Kind kind)
+            {
+                PathStep step;
+                step.kind = kind;
+                return step;
+            }
+
+            static bool isWhitespace(char c)
+            {
+                return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+            }
+
+            static bool isNameChar(char c)
+            {
+                return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '$' || c == '-' || (c & 0x80) != 0;
+            }
+
+            bool isDone() const { return _cursor >= _text.size(); }
+            char curr() const { return _text[_cursor]; }
+
+            void skipWhitespace()
+            {
+                while (!isDone() && isWhitespace(curr())) {
+                    ++_cursor;
+                }
+            }
+
+            void expect(char c)
+            {
+                if (isDone() || curr() != c) {
+                    raiseError(std::string(1, c));
+                }
+                ++_cursor;
+            }
+
+            void raiseError(const std::string& expected)
+            {
+                if (isDone()) {
+                    throw parse_exception(format("Expecting '%s' at position %d of the path but it ended instead!", expected.c_str(), static_cast<int>(_cursor) + 1));
+                }
+                throw parse_exception(format("Expecting '%s' at position %d of the path but found '%c' instead!", expected.c_str(), static_cast<int>(_cursor) + 1, curr()));
+            }
+
+            // .name or .*
+            PathStep dotted()
+            {
+                if (!isDone() && curr() == '*') {
+                    ++_cursor;
+                    return step(PathStep::Kind::WILDCARD);
+                }
+                auto result = step(PathStep::Kind::CHILD);
+                result.name = name();
+                return result;
+            }
+
+            std::string name()
+            {
+                auto start = _cursor;
+                while (!isDone() && isNameChar(curr())) {
+                    ++_cursor;
+                }
+                if (_cursor == start) {
+                    raiseError("name");
+                }
+                return std::string(_text.data() + start, _cursor - start);
+            }
+
+            // ['name'], [n], [*] or [?(...)]
+            PathStep bracket()
+            {
+                expect('[');
+                skipWhitespace();
+                PathStep result;
+                if (isDone()) {
+                    raiseError("]");
+                } else if (curr() == '*') {
+                    ++_cursor;
+                    result = step(PathStep::Kind::WILDCARD);
+                } else if (curr() == '\'' || curr() == '"') {
+                    result = step(PathStep::Kind::CHILD);
+                    result.name = quoted();
+                } else if (std::isdigit(static_cast<unsigned char>(curr()))) {
+                    result = step(PathStep::Kind::INDEX);
+                    result.index = index();
+                } else if (curr() == '?') {
+                    ++_cursor;
+                    result = step(PathStep::Kind::FILTER);
+                    result.filter = filter();
+                } else {
+                    raiseError("a name, an index, * or ?");
+                }
+                skipWhitespace();
+                expect(']');
+                return result;
+            }
+
+            std::string quoted()
+            {
+                const char quote = curr();
+                ++_cursor;
+                std::string str;
+                while (!isDone() && curr() != quote) {
+                    if (curr() == '\\') {
+                        ++_cursor;
+                        if (isDone()) {
+                            break;
+                        }
+                    }
+                    str += curr();
+                    ++_cursor;
+                }
+                expect(quote);
+                return str;
+            }
+
+            size_t index()
+            {
+                size_t value = 0;
+                while (!isDone() && std::isdigit(static_cast<unsigned char>(curr()))) {
+                    const size_t digit = curr() - '0';
+                    if (value > (std::numeric_limits<size_t>::max() - digit) / 10) {
+                        throw parse_exception(format("The index at position %d of the path is too large!", static_cast<int>(_cursor) + 1));
+                    }
+                    value = value * 10 + digit;
+                    ++_cursor;
+                }
+                if (value == PATH_NO_INDEX) {
+                    throw parse_exception(format("The index at position %d of the path is too large!", static_cast<int>(_cursor)));
+                }
+                return value;
+            }
+
+            // (@.a.b) or (@.a.b <op> literal)
+            PathFilter filter()
+            {
+                PathFilter result;
+                expect('(');
+                skipWhitespace();
+                expect('@');
+                while (!isDone() && (curr() == '.' || curr() == '[')) {
+                    if (curr() == '.') {
+                        ++_cursor;
+                        result.names.push_back(name());
+                    } else {
+                        ++_cursor;
+                        skipWhitespace();
+                        if (isDone() || (curr() != '\'' && curr() != '"')) {
+                            raiseError("a quoted name");
+                        }
+                        result.names.push_back(quoted());
+                        skipWhitespace();
+                        expect(']');
+                    }
+                }
+                skipWhitespace();
+                if (!isDone() && curr() != ')') {
+                    result.op = op();
+                    skipWhitespace();
+                    literal(result);
+                    skipWhitespace();
+                }
+                expect(')');
+                return result;
+            }
+
+            PathFilter::Op op()
+            {
+                static const struct {
+                    const char* text;
+                    PathFilter::Op op;
+                } OPS[] = {
+                    { "==", PathFilter::Op::EQ }, { "!=", PathFilter::Op::NE }, { "<=", PathFilter::Op::LE },
+                    { ">=", PathFilter::Op::GE }, { "<", PathFilter::Op::LT }, { ">", PathFilter::Op::GT }
+                };
+                for (auto& candidate : OPS) {
+                    const size_t size = std::strlen(candidate.text);
+                    if (_text.size() - _cursor >= size && std::memcmp(_text.data() + _cursor, candidate.text, size) == 0) {
+                        _cursor += size;
+                        return candidate.op;
+                    }
+                }
+                raiseError("a comparison");
+                return PathFilter::Op::EXISTS;
+            }
+
+            bool consume(const char* word)
+            {
+                const size_t size = std::strlen(word);
+                if (_text.size() - _cursor >= size && std::memcmp(_text.data() + _cursor, word, size) == 0) {
+                    _cursor += size;
+                    return true;
+                }
+                return false;
+            }
+
+            void literal(PathFilter& filter)
+            {
+                if (isDone()) {
+                    raiseError("a literal");
+                }
+                if (curr() == '\'' || curr() == '"') {
+                    filter.type = PathFilter::Type::STRING;
+                    filter.string = quoted();
+                } else if (consume("true")) {
+                    filter.type = PathFilter::Type::BOOL;
+                    filter.boolean = true;
+                } else if (consume("false")) {
+                    filter.type = PathFilter::Type::BOOL;
+                } else if (consume("null")) {
+                    filter.type = PathFilter::Type::JNULL;
+                } else if (curr() == '-' || std::isdigit(static_cast<unsigned char>(curr()))) {
+                    const char* first = _text.data() + _cursor;
+                    DecimalNumber number;
+                    const char* last = scanNumber(first, _text.end(), number);
+                    if (!number.valid) {
+                        _cursor += last - first;
+                        raiseError("digit");
+                    }
+                    _cursor += last - first;
+                    filter.type = PathFilter::Type::NUMBER;
+                    filter.number = decodeNumber(number, first, last);
+                } else {
+                    raiseError("a literal");
+                }
+            }
+        };
+
+        // Works out which steps apply to a child of a node the states of which are given. The states of a node are the
+        // indexes of the steps that apply to its children, the number of steps marks a match. Filters are left for the
+        // caller to evaluate on the child, which adds the step after a passing filter.
+        void advancePath(const std::vector<PathStep>& steps, const std::vector<size_t>& states, StringView key, size_t index,
+            std::vector<size_t>& next, std::vector<size_t>& filters)
+        {
+            for (auto state : states) {
+                if (state == steps.size()) {
+                    continue;
+                }
+                auto& step = steps[state];
+                switch (step.kind) {
+                case PathStep::Kind::CHILD:
+                    if (index == PATH_NO_INDEX && key == StringView(step.name)) {
+                        next.push_back(state + 1);
+                    }
+                    break;
+                case PathStep::Kind::INDEX:
+                    if (index == step.index) {
+                        next.push_back(state + 1);
+                    }
+                    break;
+                case PathStep::Kind::WILDCARD:
+                    next.push_back(state + 1);
+                    break;
+                case PathStep::Kind::DESCENDANT:
+                    next.push_back(state);
+                    break;
+                case PathStep::Kind::FILTER:
+                    filters.push_back(state);
+                    break;
+                }
+            }
+        }
+
+        // A descendant step also lets the step after it apply to the node itself, and no state is kept twice
+        void closePath(const std::vector<PathStep>& steps, std::vector<size_t>& states)
+        {
+            for (size_t i = 0; i < states.size(); ++i) {
+                if (states[i] < steps.size() && steps[states[i]].kind == PathStep::Kind::DESCENDANT) {
+                    states.push_back(states[i] + 1);
+                }
+            }
+            std::sort(states.begin(), states.end());
+            states.erase(std::unique(states.begin(), states.end()), states.end());
+        }
+
+        // The node adapters the evaluator is written against, for the DOM and for tape documents
+        bool isPathObject(const Value* value) { return value->isObject(); }
+        bool isPathObject(ValueView value) { return value.isObject(); }
+        bool isPathArray(const Value* value) { return value->isArray(); }
+        bool isPathArray(ValueView value) { return value.isArray(); }
+
+        const Value* pathMember(const Value* value, StringView name)
+        {
+            return value->isObject() ? static_cast<const Object*>(value)->getOwnValue(name) : nullptr;
+        }
+
+        ValueView pathMember(ValueView value, StringView name)
+        {
+            for (auto member : value.asObject()) {
+                if (member.name == name) {
+                    return member.value;
+                }
+            }
+            return ValueView();
+        }
+
+        const Value* pathElement(const Value* value, size_t index)
+        {
+            auto array = static_cast<const Array*>(value);
+            return index < array->size() ? array->getValue(index) : nullptr;
+        }
+
+        ValueView pathElement(ValueView value, size_t index)
+        {
+            return value.asArray().getValue(index);
+        }
+
+        template <class F>
+        void forEachPathChild(const Value* value, F&& visit)
+        {
+            if (value->isObject()) {
+                for (auto member : *static_cast<const Object*>(value)) {
+                    visit(member.name, PATH_NO_INDEX, static_cast<const Value*>(member.value));
+                }
+            } else if (value->isArray()) {
+                size_t index = 0;
+                for (auto element : *static_cast<const Array*>(value)) {
+                    visit(StringView(), index++, static_cast<const Value*>(element));
+                }
+            }
+        }
+
+        template <class F>
+        void forEachPathChild(ValueView value, F&& visit)
+        {
+            if (value.isObject()) {
+                for (auto member : value.asObject()) {
+                    visit(member.name, PATH_NO_INDEX, member.value);
+                }
+            } else if (value.isArray()) {
+                size_t index = 0;
+                for (auto element : value.asArray()) {
+                    visit(StringView(), index++, element);
+                }
+            }
+        }
+
+        template <class T>
+        int compareOrdered(T left, T right)
+        {
+            return left < right ? -1 : (left > right ? 1 : 0);
+        }
+
+        int comparePathString(StringView str, StringView literal)
+        {
+            const int cmp = std::memcmp(str.data(), literal.data(), std::min(str.size(), literal.size()));
+            return cmp != 0 ? (cmp < 0 ? -1 : 1) : compareOrdered(str.size(), literal.size());
+        }
+
+        // -1, 0 or 1 for two numbers that are both integers
+        int compareIntegers(const Number& left, const Number& right)
+        {
+            const bool negative = left.getInt64Value() < 0;
+            if (negative != (right.getInt64Value() < 0)) {
+                return negative ? -1 : 1;
+            } else if (negative) {
+                return compareOrdered(left.getInt64Value(), right.getInt64Value());
+            }
+            return compareOrdered(left.getUint64Value(), right.getUint64Value());
+        }
+
+        // Exact, neither side is rounded to the precision of the other, or 2 for NaN
+        int compareWithInteger(double value, const Number& integer)
+        {
+            if (std::isnan(value)) {
+                return 2;
+            } else if (value < -9223372036854775808.0) {
+                return -1;
+            } else if (value >= 18446744073709551616.0) {
+                return 1;
+            }
+            const double whole = std::trunc(value);
+            const int cmp = compareIntegers(whole < 0 ? Number(static_cast<std::int64_t>(whole)) : Number(static_cast<std::uint64_t>(whole)), integer);
+            return cmp != 0 ? cmp : compareOrdered(value - whole, 0.0);
+        }
+
+        // Integers are not compared as doubles, which cannot tell large ids apart
+        int comparePathNumber(const Number& number, const NumberLiteral& literal)
+        {
+            const Number other = toNumber(literal);
+            if (number.isInteger() && other.isInteger()) {
+                return compareIntegers(number, other);
+            } else if (number.isInteger()) {
+                const int cmp = compareWithInteger(other.getValue(), number);
+                return cmp == 2 ? 2 : -cmp;
+            } else if (other.isInteger()) {
+                return compareWithInteger(number.getValue(), other);
+            }
+            const double value = number.getValue();
+            const double literalValue = other.getValue();
+            return value < literalValue ? -1 : (value > literalValue ? 1 : (value == literalValue ? 0 : 2));
+        }
+
+        // Compares with the literal of a filter, -1, 0 or 1, or 2 when the values cannot be ordered
+        int comparePathLiteral(const Value* value, const PathFilter& filter)
+        {
+            switch (filter.type) {
+            case PathFilter::Type::STRING:
+                if (value->isString()) {
+                    return comparePathString(static_cast<const String*>(value)->getStringView(), filter.string);
+                }
+                break;
+            case PathFilter::Type::NUMBER:
+                if (value->isNumber()) {
+                    return comparePathNumber(*static_cast<const Number*>(value), filter.number);
+                }
+                break;
+            case PathFilter::Type::BOOL:
+                if (value->isBool()) {
+                    return static_cast<const Bool*>(value)->getValue() == filter.boolean ? 0 : 2;
+                }
+                break;
+            case PathFilter::Type::JNULL:
+                return value->isNull() ? 0 : 2;
+            }
+            return 2;
+        }
+
+        int comparePathLiteral(ValueView value, const PathFilter& filter)
+        {
+            switch (filter.type) {
+            case PathFilter::Type::STRING:
+                if (value.isString()) {
+                    return comparePathString(value.asString(), filter.string);
+                }
+                break;
+            case PathFilter::Type::NUMBER:
+                if (value.isInteger()) {
+                    const std::int64_t int64 = value.asInt64();
+                    return comparePathNumber(int64 < 0 ? Number(int64) : Number(value.asUint64()), filter.number);
+                } else if (value.isNumber()) {
+                    return comparePathNumber(Number(value.asNumber()), filter.number);
+                }
+                break;
+            case PathFilter::Type::BOOL:
+                if (value.isBool()) {
+                    return value.asBool() == filter.boolean ? 0 : 2;
+                }
+                break;
+            case PathFilter::Type::JNULL:
+                return value.isNull() ? 0 : 2;
+            }
+            return 2;
+        }
+
+        template <class Node>
+        bool matchesPathFilter(Node node, const PathFilter& filter)
+        {
+            for (auto& name : filter.names) {
+                node = pathMember(node, name);
+                if (!node) {
+                    return false;
+                }
+            }
+
+            const int cmp = filter.op == PathFilter::Op::EXISTS ? 0 : comparePathLiteral(node, filter);
+            switch (filter.op) {
+            case PathFilter::Op::EXISTS: return true;
+            case PathFilter::Op::EQ: return cmp == 0;
+            case PathFilter::Op::NE: return cmp != 0;
+            case PathFilter::Op::LT: return cmp == -1;
+            case PathFilter::Op::LE: return cmp == -1 || cmp == 0;
+            case PathFilter::Op::GT: return cmp == 1;
+            case PathFilter::Op::GE: return cmp == 1 || cmp == 0;
+            }
+            return false;
+        }
+
+        /**
+         * Runs the steps over a tree depth first, so every node is visited once with all the steps that apply to it and
+         * the matches come out in document order. A node with a single name or index step is looked up directly
+         * instead of walking its children.
+         */
+        template <class Node>
+        class PathEvaluator {
+        public:
+            PathEvaluator(const std::vector<PathStep>& steps, std::vector<Node>& matches) : _steps(steps), _matches(matches) {}
+
+            void run(Node node, std::vector<size_t> states)
+            {
+                closePath(_steps, states);
+                visit(node, states);
+            }
+        private:
+            const std::vector<PathStep>& _steps;
+            std::vector<Node>& _matches;
+
+            void visit(Node node, const std::vector<size_t>& states)
+            {
+                if (states.back() == _steps.size()) {
+                    _matches.push_back(node);
+                    if (states.size() == 1) {
+                        return;
+                    }
+                }
+
+                if (states.size() == 1) {
+                    auto& step = _steps[states[0]];
+                    if (step.kind == PathStep::Kind::CHILD && isPathObject(node)) {
+                        auto child = pathMember(node, step.name);
+                        if (child) {
+                            run(child, { states[0] + 1 });
+                        }
+                        return;
+                    }
+                    if (step.kind == PathStep::Kind::INDEX && isPathArray(node)) {
+                        auto child = pathElement(node, step.index);
+                        if (child) {
+                            run(child, { states[0] + 1 });
+                        }
+                        return;
+                    }
+                }
+
+                std::vector<size_t> next;
+                std::vector<size_t> filters;
+                forEachPathChild(node, [&](StringView key, size_t index, Node child) {
+                    next.clear();
+                    filters.clear();
+                    advancePath(_steps, states, key, index, next, filters);
+                    for (auto filter : filters) {
+                        if (matchesPathFilter(child, _steps[filter].filter)) {
+                            next.push_back(filter + 1);
+                        }
+                    }
+                    if (!next.empty()) {
+                        run(child, next);
+                    }
+                });
+            }
+        };
+
+        /**
+         * Builds a copy of a value out of the events that make it up, one open container at a time.
+         */
+        class ValueCapture {
+        public:
+            size_t depth() const { return _levels.size(); }
+
+            void start(std::unique_ptr<Value> container)
+            {
+                _levels.push_back({ std::move(container), std::string() });
+            }
+
+            void key(StringView name)
+            {
+                _levels.back().key.assign(name.data(), name.size());
+            }
+
+            std::unique_ptr<Value> end()
+            {
+                auto container = std::move(_levels.back().container);
+                _levels.pop_back();
+                return container;
+            }
+
+            // into the innermost open container
+            void add(std::unique_ptr<Value> value)
+            {
+                auto& level = _levels.back();
+                if (level.container->isObject()) {
+                    static_cast<Object*>(level.container.get())->addValue(level.key, std::move(value));
+                } else {
+                    static_cast<Array*>(level.container.get())->addValue(std::move(value));
+                }
+            }
+        private:
+            struct Level {
+                std::unique_ptr<Value> container;
+                std::string key;
+            };
+            std::vector<Level> _levels;
+        };
+    }
+
+    Path::Path(StringView expression)
+        : _steps(detail::PathCompiler(expression).compile()) {}
+
+    std::vector<Value*> Path::select(const Value* root) const
+    {
+        std::vector<const Value*> matches;
+        if (root != nullptr) {
+            detail::PathEvaluator<const Value*>(_steps, matches).run(root, { 0 });
+        }
+        std::vector<Value*> values;
+        values.reserve(matches.size());
+        for (auto match : matches) {
+            values.push_back(const_cast<Value*>(match));
+        }
+        return values;
+    }
+
+    std::vector<ValueView> Path::select(ValueView root) const
+    {
+        std::vector<ValueView> matches;
+        if (root) {
+            detail::PathEvaluator<ValueView>(_steps, matches).run(root, { 0 });
+        }
+        return matches;
+    }
+
+    void Path::stream(StringView text, const std::function<void(const Value&)>& callback) const
+    {
+        PathHandler handler(*this, callback);
+        parse(text, &handler);
+    }
+
+    PathHandler::PathHandler(const Path& path, std::function<void(const Value&)> callback)
+        : _steps(path._steps), _callback(std::move(callback)), _capture(std::make_unique<detail::ValueCapture>()) {}
+
+    PathHandler::~PathHandler() {}
+
+    void PathHandler::startValue(bool container, const std::function<std::unique_ptr<Value>()>& create)
+    {
+        std::vector<size_t> states;
+        std::vector<size_t> filters;
+        if (_frames.empty()) {
+            states.push_back(0);
+        } else {
+            auto& parent = _frames.back();
+            const size_t index = parent.array ? parent.nextIndex++ : detail::PATH_NO_INDEX;
+            detail::advancePath(_steps, parent.states, parent.key, index, states, filters);
+        }
+        detail::closePath(_steps, states);
+
+        // matches and values that still have to pass a filter are captured until they end
+        const size_t depth = _capture->depth();
+        if (!states.empty() && states.back() == _steps.size()) {
+            _captures.push_back({ _steps.size(), depth });
+        }
+        for (auto filter : filters) {
+            _captures.push_back({ filter, depth });
+        }
+
+        // only values inside a capture are built, once, however many captures they are in
+        if (container) {
+            if (!_captures.empty()) {
+                _capture->start(create());
+            }
+            if (!states.empty() && states.back() == _steps.size()) {
+                states.pop_back();
+            }
+            _frames.push_back({ std::move(states), false, 0, std::string() });
+        } else if (!_captures.empty()) {
+            // a scalar is complete as soon as it starts
+            endValue(create());
+        }
+    }
+
+    void PathHandler::endValue(std::unique_ptr<Value> value)
+    {
+        // the captures that end here are the innermost ones, they see the value before it goes into its container
+        const size_t depth = _capture->depth();
+        size_t first = _captures.size();
+        while (first != 0 && _captures[first - 1].depth == depth) {
+            --first;
+        }
+        for (size_t i = first; i < _captures.size(); ++i) {
+            finish(_captures[i], *value);
+        }
+        _captures.resize(first);
+
+        if (depth != 0) {
+            _capture->add(std::move(value));
+        }
+    }
+
+    void PathHandler::endContainer()
+    {
+        _frames.pop_back();
+        if (!_captures.empty()) {
+            endValue(_capture->end());
+        }
+    }
+
+    void PathHandler::finish(const Capture& capture, const Value& value)
+    {
+        if (capture.continuation == _steps.size()) {
+            _callback(value);
+            return;
+        }
+
+        // the value is a child of a filter step, the steps after the filter run on the built value
+        auto& filter = _steps[capture.continuation].filter;
+        if (!detail::matchesPathFilter(&value, filter)) {
+            return;
+        }
+        std::vector<const Value*> matches;
+        detail::PathEvaluator<const Value*>(_steps, matches).run(&value, { capture.continuation + 1 });
+        for (auto match : matches) {
+            _callback(*match);
+        }
+    }
+
+    void PathHandler::startObject()
+    {
+        startValue(true, [] { return std::make_unique<Object>(); });
+    }
+
+    void PathHandler::key(StringView name)
+    {
+        _frames.back().key.assign(name.data(), name.size());
+        if (!_captures.empty()) {
+            _capture->key(name);
+        }
+    }
+
+    void PathHandler::endObject()
+    {
+        endContainer();
+    }
+
+    void PathHandler::startArray()
+    {
+        startValue(true, [] { return std::make_unique<Array>(); });
+        _frames.back().array = true;
+    }
+
+    void PathHandler::endArray()
+    {
+        endContainer();
+    }
+
+    void PathHandler::string(StringView value)
+    {
+        startValue(false, [&] { return std::make_unique<String>(value.str()); });
+    }
+
+    void PathHandler::number(const Number& value)
+    {
+        startValue(false, [&] { return std::make_unique<Number>(value); });
+    }
+
+    void PathHandler::boolean(bool value)
+    {
+        startValue(false, [&] { return std::make_unique<Bool>(value); });
+    }
+
+    void PathHandler::null()
+    {
+        startValue(false, [] { return std::make_unique<Null>(); });
+    }
+
+    PushParser::PushParser(ParseHandler* handler, size_t maxDepth)
+        : _handler(handler), _maxDepth(maxDepth), _lexState(LexState::NONE), _parseState(ParseState::ROOT), _numberState(NumberState::SIGN),
+          _literal(nullptr), _literalType(detail::TokenType::NONE), _unicodeDigits(0), _unicodeValue(0), _highSurrogate(0), _line(1), _pos(1), _tokenLine(1), _tokenPos(1) {}
+
+    bool PushParser::isComplete() const
+    {
+        return _parseState == ParseState::DONE;
+    }
+
+    void PushParser::raiseLexError(const std::string& expected, char found)
+    {
+        throw parse_exception(detail::format("Expecting '%s' at line %d:%d but found '%c' instead!", expected.c_str(), _line, _pos, found));
+    }
+
+    void PushParser::raiseError(const std::string& expected)
+    {
+        throw parse_exception(detail::format("Expecting '%s' at line %d:%d but got '%s' instead!", expected.c_str(), _tokenLine, _tokenPos, _token.c_str()));
+    }
+
+    bool PushParser::advanceNumber(char c)
+    {
+        const bool digit = detail::isDigit(c);
+        switch (_numberState) {
+        case NumberState::SIGN:
+        case NumberState::FRACTION_START:
+        case NumberState::EXPONENT_SIGN:
+            if (!digit) {
+                return false;
+            }
+            _numberState = _numberState == NumberState::SIGN ? NumberState::INTEGER
+                : _numberState == NumberState::FRACTION_START ? NumberState::FRACTION : NumberState::EXPONENT;
+            return true;
+        case NumberState::INTEGER:
+            if (c == '.') {
+                _numberState = NumberState::FRACTION_START;
+                return true;
+            }
+            // fall through
+        case NumberState::FRACTION:
+            if (c == 'e' || c == 'E') {
+                _numberState = NumberState::EXPONENT_START;
+                return true;
+            }
+            return digit;
+        case NumberState::EXPONENT_START:
+            if (c == '+' || c == '-') {
+                _numberState = NumberState::EXPONENT_SIGN;
+                return true;
+            }
+            if (digit) {
+                _numberState = NumberState::EXPONENT;
+            }
+            return digit;
+        default:
+            return digit;
+        }
+    }
+
+    void PushParser::finishNumber()
+    {
+        _lexState = LexState::NONE;
+        const char* first = _token.data();
+        const char* last = first + _token.size();
+        detail::DecimalNumber decimal;
+        detail::scanNumber(first, last, decimal);
+        const Number number = detail::toNumber(detail::decodeNumber(decimal, first, last));
+        token(detail::TokenType::NUMBER, &number);
+    }
+
+    void PushParser::openContainer(bool isObject)
+    {
+        if (_inObject.size() >= _maxDepth) {
+            throw parse_exception(detail::format("The document is nested deeper than %d levels at line %d:%d!",
+                static_cast<int>(std::min<size_t>(_maxDepth, std::numeric_limits<int>::max())), _tokenLine, _tokenPos));
+        }
+        if (isObject) {
+            _handler->startObject();
+        } else {
+            _handler->startArray();
+        }
+        _inObject.push_back(isObject);
+        _parseState = isObject ? ParseState::FIRST_KEY : ParseState::FIRST_VALUE;
+    }
+
+    void PushParser::endValue()
+    {
+        _parseState = _inObject.empty() ? ParseState::DONE : ParseState::AFTER_VALUE;
+    }
+
+    void PushParser::scalar(detail::TokenType type, const Number* number)
+    {
+        switch (type) {
+        case detail::TokenType::STRING:
+            _handler->string(_token);
+            break;
+        case detail::TokenType::NUMBER:
+            _handler->number(*number);
+            break;
+        case detail::TokenType::JBOOL:
+            _handler->boolean(_token == "true");
+            break;
+        case detail::TokenType::JNULL:
+            _handler->null();
+            break;
+        case detail::TokenType::LBRACE:
+            openContainer(true);
+            return;
+        case detail::TokenType::LBRACKET:
+            openContainer(false);
+            return;
+        default:
+            raiseError("<value>");
+        }
+        endValue();
+    }
+
+    void PushParser::token(detail::TokenType type, const Number* number)
+    {
+        switch (_parseState) {
+        case ParseState::ROOT:
+            if (type != detail::TokenType::LBRACE) {
+                raiseError("{");
+            }
+            scalar(type, number);
+            break;
+        case ParseState::FIRST_KEY:
+            if (type == detail::TokenType::RBRACE) {
+                _handler->endObject();
+                _inObject.pop_back();
+                endValue();
+                break;
+            }
+            // fall through
+        case ParseState::KEY:
+            if (type != detail::TokenType::STRING) {
+                raiseError("<string>");
+            }
+            _handler->key(_token);
+            _parseState = ParseState::COLON;
+            break;
+        case ParseState::COLON:
+            if (type != detail::TokenType::COLON) {
+                raiseError(":");
+            }
+            _parseState = ParseState::VALUE;
+            break;
+        case ParseState::FIRST_VALUE:
+            if (type == detail::TokenType::RBRACKET) {
+                _handler->endArray();
+                _inObject.pop_back();
+                endValue();
+                break;
+            }
+            // fall through
+        case ParseState::VALUE:
+            scalar(type, number);
+            break;
+        case ParseState::AFTER_VALUE:
+            if (type == detail::TokenType::COMMA) {
+                _parseState = _inObject.back() ? ParseState::KEY : ParseState::VALUE;
+            } else if (_inObject.back() && type == detail::TokenType::RBRACE) {
+                _handler->endObject();
+                _inObject.pop_back();
+                endValue();
+            } else if (!_inObject.back() && type == detail::TokenType::RBRACKET) {
+                _handler->endArray();
+                _inObject.pop_back();
+                endValue();
+            } else {
+                raiseError(_inObject.back() ? "}" : "]");
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    void PushParser::addCodeUnit(std::uint32_t unit)
+    {
+        if (_highSurrogate != 0) {
+            if (detail::isLowSurrogate(unit)) {
+                detail::appendUtf8(_token, detail::combineSurrogates(_highSurrogate, unit));
+                _highSurrogate = 0;
+                return;
+            }
+            flushSurrogate();
+        }
+        if (detail::isHighSurrogate(unit)) {
+            _highSurrogate = unit; // the low half may follow as the next escape
+            return;
+        }
+        detail::appendUtf8(_token, unit);
+    }
+
+    void PushParser::flushSurrogate()
+    {
+        detail::appendUtf8(_token, _highSurrogate);
+        _highSurrogate = 0;
+    }
+
+    void PushParser::startToken(char c)
+    {
+        _tokenLine = _line;
+        _tokenPos = _pos;
+        _token.assign(1, c);
+        ++_pos;
+
+        switch (c) {
+        case '{':
+            token(detail::TokenType::LBRACE);
+            break;
+        case '}':
+            token(detail::TokenType::RBRACE);
+            break;
+        case '[':
+            token(detail::TokenType::LBRACKET);
+            break;
+        case ']':
+            token(detail::TokenType::RBRACKET);
+            break;
+        case ':':
+            token(detail::TokenType::COLON);
+            break;
+        case ',':
+            token(detail::TokenType::COMMA);
+            break;
+        case '\"':
+            _token.clear();
+            _lexState = LexState::STRING;
+            break;
+        case 't':
+        case 'f':
+            _literal = c == 't' ? "true" : "false";
+            _literalType = detail::TokenType::JBOOL;
+            _lexState = LexState::LITERAL;
+            break;
+        case 'n':
+            _literal = "null";
+            _literalType = detail::TokenType::JNULL;
+            _lexState = LexState::LITERAL;
+            break;
+        default:
+            if (c == '-' || c == '+' || detail::isDigit(c)) {
+                _numberState = detail::isDigit(c) ? NumberState::INTEGER : NumberState::SIGN;
+                _lexState = LexState::NUMBER;
+            } else {
+                --_pos;
+                raiseLexError("<value>", c);
+            }
+        }
+    }
+
+    size_t PushParser::feed(const char* data, size_t size)
+    {
+        const char* p = data;
+        const char* last = data + size;
+        while (p != last && _parseState != ParseState::DONE) {
+            const char c = *p;
+            switch (_lexState) {
+            case LexState::NONE:
+                if (std::isspace(static_cast<unsigned char>(c))) {
+                    if (c == '\n') {
+                        ++_line;
+                        _pos = 0;
+                    }
+                    ++_pos;
+                } else {
+                    startToken(c);
+                }
+                ++p;
+                break;
+            case LexState::STRING: {
+                if (_highSurrogate != 0 && c != '\\') {
+                    flushSurrogate();
+                }
+
+                // copy the run of characters that need no special handling in one go
+                const char* special = detail::findStringSpecial(p, last);
+                _token.append(p, special);
+                _pos += static_cast<int>(special - p);
+                p = special;
+                if (p == last) {
+                    break;
+                }
+                if (*p == '\"') {
+                    _lexState = LexState::NONE;
+                    token(detail::TokenType::STRING);
+                } else if (*p == '\\') {
+                    _lexState = LexState::STRING_ESCAPE;
+                } else {
+                    _token += *p; // control characters are kept as they are
+                }
+                ++_pos;
+                ++p;
+                break;
+            }
+            case LexState::STRING_ESCAPE:
+                if (c == 'b' || c == 'f' || c == 'n' || c == 'r' || c == 't' || c == '\"' || c == '\\' || c == '/') {
+                    if (_highSurrogate != 0) {
+                        flushSurrogate();
+                    }
+                    _token += detail::decodeShortEscape(c);
+                } else if (c == 'u') {
+                    _unicodeDigits = 0;
+                    _unicodeValue = 0;
+                } else {
+                    raiseLexError(R"(("|\|/|b|f|n|r|t) control character)", c);
+                }
+                _lexState = c == 'u' ? LexState::STRING_UNICODE : LexState::STRING;
+                ++_pos;
+                ++p;
+                break;
+            case LexState::STRING_UNICODE:
+                if (std::isxdigit(static_cast<unsigned char>(c)) && _unicodeDigits < 4) {
+                    _unicodeValue = _unicodeValue << 4 | detail::hexValue(c);
+                    ++_unicodeDigits;
+                    ++_pos;
+                    ++p;
+                } else if (_unicodeDigits != 4 || std::isxdigit(static_cast<unsigned char>(c))) {
+                    throw parse_exception(detail::format("Only 4 hexadecimal values accepted at line %d:%d", _line, _pos));
+                } else {
+                    addCodeUnit(_unicodeValue);
+                    _lexState = LexState::STRING; // look at the character again as part of the string
+                }
+                break;
+            case LexState::NUMBER:
+                if (advanceNumber(c)) {
+                    _token += c;
+                    ++_pos;
+                    ++p;
+                } else if (_numberState == NumberState::INTEGER || _numberState == NumberState::FRACTION || _numberState == NumberState::EXPONENT) {
+                    finishNumber(); // look at the character again as the start of the next token
+                } else {
+                    raiseLexError("digit", c);
+                }
+                break;
+            case LexState::LITERAL:
+                if (c != _literal[_token.size()]) {
+                    raiseLexError(std::string("value sequence ") + _literal, c);
+                }
+                _token += c;
+                ++_pos;
+                ++p;
+                if (_literal[_token.size()] == '\0') {
+                    _lexState = LexState::NONE;
+                    token(_literalType);
+                }
+                break;
+            }
+        }
+        return p - data;
+    }
+
+    void PushParser::finish()
+    {
+        switch (_lexState) {
+        case LexState::NUMBER:
+            if (_numberState != NumberState::INTEGER && _numberState != NumberState::FRACTION && _numberState != NumberState::EXPONENT) {
+                raiseLexError("digit", '\0');
+            }
+            finishNumber();
+            break;
+        case LexState::LITERAL:
+            raiseLexError(std::string("value sequence ") + _literal, '\0');
+            break;
+        case LexState::NONE:
+            break;
+        default:
+            raiseLexError("Terminating \" for string", '\0');
+        }
+
+        if (_parseState != ParseState::DONE) {
+            _tokenLine = _line;
+            _tokenPos = _pos;
+            _token.clear();
+            switch (_parseState) {
+            case ParseState::ROOT:
+                raiseError("{");
+                break;
+            case ParseState::FIRST_KEY:
+            case ParseState::KEY:
+                raiseError("<string>");
+                break;
+            case ParseState::COLON:
+                raiseError(":");
+                break;
+            case ParseState::AFTER_VALUE:
+                raiseError(_inObject.back() ? "}" : "]");
+                break;
+            default:
+                raiseError("<value>");
+            }
+        }
     }
 }
@@ -1,8 +1,14 @@
 ﻿#pragma once
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
 #include <string>
 #include <stdexcept>
+#include <type_traits>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <vector>
 
 namespace json {
@@ -11,13 +17,252 @@ namespace json {
         parse_exception(const std::string& msg);
     };
 
+    // What went wrong when the text could not be parsed
+    enum class ParseErrorCode {
+        NONE,
+        UNEXPECTED_CHARACTER, // the lexer found a character that cannot continue the token
+        DANGLING_ESCAPE, // the text ends right after a backslash
+        INVALID_UNICODE_ESCAPE, // a \u escape without exactly 4 hexadecimal digits
+        INVALID_TOKEN, // a character that cannot start a token
+        UNEXPECTED_TOKEN, // the parser got a token the grammar does not allow there
+        TOO_DEEP, // nested deeper than ParseOptions::maxDepth
+        TOO_LARGE, // a key too long to be interned
+        OUT_OF_MEMORY,
+        INTERNAL_ERROR // anything else that was thrown while parsing
+    };
+
+    /**
+     * A non-owning view over a contiguous sequence of characters. The viewed characters are
+     * not copied, so they must outlive the view and anything that borrows from it.
+     */
+    class StringView {
+    public:
+        StringView() : _data(""), _size(0) {}
+        StringView(const char* data, size_t size) : _data(data), _size(size) {}
+        StringView(const char* str) : _data(str), _size(std::char_traits<char>::length(str)) {}
+        StringView(const std::string& str) : _data(str.data()), _size(str.size()) {}
+
+        const char* data() const { return _data; }
+        size_t size() const { return _size; }
+        bool empty() const { return _size == 0; }
+        char operator[](size_t index) const { return _data[index]; }
+
+        const char* begin() const { return _data; }
+        const char* end() const { return _data + _size; }
+
+        std::string str() const { return std::string(_data, _size); }
+    private:
+        const char* _data;
+        size_t _size;
+    };
+
+    bool operator==(StringView lhs, StringView rhs);
+    bool operator!=(StringView lhs, StringView rhs);
+
     struct ValueVisitor;
+    struct ParseHandler;
+
+    namespace detail {
+
+        /**
+         * A bump allocator that hands out memory from large chunks and frees all of it at once when destroyed.
+         * Each chunk is twice as big as the previous one.
+         */
+        class Arena {
+        public:
+            Arena(size_t firstChunkSize = 4096);
+            ~Arena();
+            Arena(const Arena&) = delete;
+            Arena& operator=(const Arena&) = delete;
+
+            void* allocate(size_t size, size_t alignment);
+            char* copy(StringView str);
+            bool owns(const void* p) const; // whether p points into one of the chunks
+        private:
+            struct Chunk {
+                Chunk* previous;
+                char* end;
+            };
+            Chunk* _chunk;
+            char* _cursor;
+            char* _end;
+            size_t _nextChunkSize;
+
+            void grow(size_t minimumSize);
+        };
+
+        /**
+         * A standard allocator that allocates from an arena, or from the heap when there is no arena.
+         */
+        template <class T>
+        class ArenaAllocator {
+        public:
+            using value_type = T;
+
+            ArenaAllocator(Arena* arena = nullptr) : arena(arena) {}
+
+            template <class U>
+            ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+            T* allocate(size_t n)
+            {
+                if (arena != nullptr) {
+                    return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+                }
+                return static_cast<T*>(::operator new(n * sizeof(T)));
+            }
+
+            void deallocate(T* p, size_t)
+            {
+                if (arena == nullptr) {
+                    ::operator delete(p);
+                }
+            }
+
+            Arena* arena;
+        };
+
+        template <class T, class U>
+        bool operator==(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) { return lhs.arena == rhs.arena; }
+
+        template <class T, class U>
+        bool operator!=(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) { return lhs.arena != rhs.arena; }
+    }
+
+    class KeyTable;
+
+    namespace detail {
+
+        // The characters of an interned key follow its entry
+        struct KeyEntry {
+            const KeyTable* table;
+            std::uint32_t hash;
+            std::uint32_t size;
+        };
+    }
+
+    /**
+     * A handle to a key held by a KeyTable. Handles to equal keys of the same table point to the same entry,
+     * so comparing them is a pointer comparison. A default constructed handle refers to no key.
+     */
+    class InternedKey {
+    public:
+        InternedKey() : _entry(nullptr) {}
+
+        explicit operator bool() const { return _entry != nullptr; }
+        bool operator==(InternedKey other) const { return _entry == other._entry; }
+        bool operator!=(InternedKey other) const { return _entry != other._entry; }
+
+        StringView name() const { return StringView(reinterpret_cast<const char*>(_entry + 1), _entry->size); }
+        std::uint32_t hash() const { return _entry->hash; }
+        const KeyTable* table() const { return _entry->table; }
+    private:
+        explicit InternedKey(const detail::KeyEntry* entry) : _entry(entry) {}
+
+        const detail::KeyEntry* _entry;
+
+        friend class KeyTable;
+        friend class Object;
+    };
+
+    /**
+     * A thread safe set of object keys that can be shared by any number of documents, e.g. all the records of a
+     * stream with the same handful of field names. Objects parsed with a table point to its single copy of each key
+     * instead of holding their own, and looking up an InternedKey in them compares pointers. The table only grows.
+     */
+    class KeyTable {
+    public:
+        KeyTable();
+        KeyTable(const KeyTable&) = delete;
+        KeyTable& operator=(const KeyTable&) = delete;
+
+        // Returns the handle to the key, adding it to the table if it is not there yet
+        InternedKey intern(StringView name);
+
+        // Returns the handle to the key, or an empty handle if the table does not hold it
+        InternedKey find(StringView name) const;
+
+        size_t size() const;
+    private:
+        mutable std::shared_timed_mutex _mutex;
+        detail::Arena _entries;
+        std::vector<const detail::KeyEntry*> _slots; // open addressing, at most half full
+        size_t _size;
+
+        const detail::KeyEntry* lookup(StringView name, std::uint32_t hash) const;
+    };
+
+    namespace detail {
+
+        class Shape;
+    }
+
+    /**
+     * A thread safe set of object layouts (hidden classes) that can be shared by any number of documents. Objects parsed
+     * with the same keys in the same order share one shape that maps the keys to the slots of their values, so each of
+     * them only stores the values. The keys are interned in the table's KeyTable.
+     *
+     * Objects fall back to a layout of their own when they have more than MAX_MEMBERS members or when the table already
+     * holds MAX_SHAPES shapes, which keeps the table small for documents whose objects are used as maps.
+     */
+    class ShapeTable {
+    public:
+        static const size_t MAX_MEMBERS = 64;
+        static const size_t MAX_SHAPES = 16384;
+
+        ShapeTable(std::shared_ptr<KeyTable> keys = std::make_shared<KeyTable>());
+        ~ShapeTable();
+        ShapeTable(const ShapeTable&) = delete;
+        ShapeTable& operator=(const ShapeTable&) = delete;
+
+        const std::shared_ptr<KeyTable>& getKeys() const;
+
+        // The number of distinct layouts seen so far
+        size_t size() const;
+    private:
+        mutable std::shared_timed_mutex _mutex;
+        std::shared_ptr<KeyTable> _keys;
+        std::vector<std::unique_ptr<detail::Shape>> _shapes; // the first one is the empty shape
+
+        // Returns the shape of an object with the given shape, or the empty one if null, once the name is added to it.
+        // Returns null if the object should get a layout of its own.
+        detail::Shape* transition(detail::Shape* from, InternedKey name);
+
+        friend class Object;
+    };
+
+    namespace detail {
+
+        struct KeyIndex;
+
+        // What the root object of a parsed document owns on behalf of the whole document
+        struct DocumentResources {
+            DocumentResources();
+            ~DocumentResources();
+
+            std::unique_ptr<Arena> arena;
+            std::shared_ptr<KeyTable> keys; // the key table of the shapes when there are shapes
+            std::shared_ptr<ShapeTable> shapes;
+
+            bool indexKeys;
+            std::uint64_t generation; // bumped by every addValue anywhere in the document so the key index knows when it is out of date
+            std::mutex keyIndexMutex;
+            std::unique_ptr<KeyIndex> keyIndex; // built by the first lookup that needs it
+        };
+    }
 
     class Value {
     public:
         virtual ~Value() {}
         virtual void accept(ValueVisitor* visitor) const = 0;
 
+        // Values either come from the heap or from the arena of a parsed document, which frees them all at once.
+        // Arena allocated values must not be deleted, detail::releaseValue only runs their destructor.
+        static void* operator new(size_t size);
+        static void* operator new(size_t size, detail::Arena& arena);
+        static void operator delete(void* p);
+        static void operator delete(void* p, detail::Arena& arena);
+
         bool isObject() const;
         bool isArray() const;
         bool isString() const;
@@ -42,59 +287,165 @@ namespace json {
     class Object;
     class Array;
 
+    namespace detail {
+
+        using ValueList = std::vector<std::unique_ptr<Value>, ArenaAllocator<std::unique_ptr<Value>>>;
+
+        // Destroys the value, and frees it unless it was allocated from the arena
+        void releaseValue(std::unique_ptr<Value> value, Arena* arena);
+
+        // Destroys the values in a loop rather than by recursing into the nested objects and arrays, so destroying
+        // a document takes the same stack however deep it goes
+        void destroyValues(ValueList& values);
+
+        // Makes the containers of a value added to a parsed document report their own changes to the document
+        void attachToDocument(Value* value, DocumentResources* document);
+    }
+
     class Array : public Value {
     public:
         Array();
+        Array(detail::DocumentResources* document); // an array of a parsed document, which uses the document's resources
+        ~Array();
         void addValue(std::unique_ptr<Value> value);
         size_t size() const;
 
-        std::vector<Value*> getValues() const;
+        /**
+         * Iterates over the elements in place, e.g. for (Value* value : *array).
+         */
+        class Iterator {
+        public:
+            using Base = detail::ValueList::const_iterator;
+
+            explicit Iterator(Base it) : _it(it) {}
+
+            Value* operator*() const { return _it->get(); }
+            Iterator& operator++() { ++_it; return *this; }
+            bool operator==(const Iterator& other) const { return _it == other._it; }
+            bool operator!=(const Iterator& other) const { return _it != other._it; }
+        private:
+            Base _it;
+        };
+
+        Iterator begin() const { return Iterator(_values.begin()); }
+        Iterator end() const { return Iterator(_values.end()); }
+
+        std::vector<Value*> getValues() const; // a copy, iterating the array directly does not allocate
         Value* getValue(size_t index) const;
         Object* getObjectValue(size_t index) const;
         Array* getArrayValue(size_t index) const;
 
         std::string getStringValue(size_t index, const std::string& defaulValue = "") const;
+        StringView getStringView(size_t index, StringView defaultValue = StringView()) const; // valid while the string is
         bool getBoolValue(size_t index, bool defaultValue = false) const;
         double getNumberValue(size_t index, double defaultValue = 0.0f) const;
+        std::int64_t getInt64Value(size_t index, std::int64_t defaultValue = 0) const;
+        std::uint64_t getUint64Value(size_t index, std::uint64_t defaultValue = 0) const;
         void* getNullValue(size_t index) const;
 
         virtual void accept(ValueVisitor* visitor) const override;
     private:
-        std::vector<std::unique_ptr<Value>> _values;
+        detail::DocumentResources* _resources; // null for arrays that are not part of a parsed document
+        detail::DocumentResources* _attachedTo; // the parsed document the array is in, also when added after parsing
+        detail::ValueList _values;
+
+        friend void detail::destroyValues(detail::ValueList& values);
+        friend void detail::attachToDocument(Value* value, detail::DocumentResources* document);
     };
 
     class Object : public Value {
     public:
         Object();
+        Object(detail::DocumentResources* document); // an object of a parsed document, which uses the document's resources
+        Object(std::unique_ptr<detail::DocumentResources> document); // the root of a parsed document, which owns the resources
+        ~Object();
 
-        std::map<std::string, Value*> getValues() const;
+        struct Member {
+            StringView name;
+            Value* value;
+        };
+
+        /**
+         * Iterates over the members in place and in insertion order, e.g. for (Object::Member member : *object).
+         */
+        class Iterator {
+        public:
+            Iterator(const Object* object, size_t index) : _object(object), _index(index) {}
+
+            Member operator*() const;
+            Iterator& operator++() { ++_index; return *this; }
+            bool operator==(const Iterator& other) const { return _index == other._index; }
+            bool operator!=(const Iterator& other) const { return _index != other._index; }
+        private:
+            const Object* _object;
+            size_t _index;
+        };
+
+        Iterator begin() const { return Iterator(this, 0); }
+        Iterator end() const { return Iterator(this, _values.size()); }
+
+        std::map<std::string, Value*> getValues() const; // a sorted copy, iterating the object directly does not allocate
 
         size_t size() const;
 
-        Value* getValue(const std::string& name) const;
-        Object* getObjectValue(const std::string& name) const;
-        Array* getArrayValue(const std::string& name) const;
+        Value* getValue(StringView name) const;
+        Value* getValue(InternedKey key) const; // compares pointers when the object was parsed with the key's table
+        Value* getOwnValue(StringView name) const; // only looks at the members of this object
+        Object* getObjectValue(StringView name) const;
+        Array* getArrayValue(StringView name) const;
+
+        std::string getStringValue(StringView name, const std::string& defaulValue = "") const;
+        StringView getStringView(StringView name, StringView defaultValue = StringView()) const; // valid while the string is
+        bool getBoolValue(StringView name, bool defaultValue = false) const;
+        double getNumberValue(StringView name, double defaultValue = 0.0f) const;
+        std::int64_t getInt64Value(StringView name, std::int64_t defaultValue = 0) const;
+        std::uint64_t getUint64Value(StringView name, std::uint64_t defaultValue = 0) const;
+        void* getNullValue(StringView name) const;
 
-        std::string getStringValue(const std::string& name, const std::string& defaulValue = "") const;
-        bool getBoolValue(const std::string& name, bool defaultValue = false) const;
-        double getNumberValue(const std::string& name, double defaultValue = 0.0f) const;
-        void* getNullValue(const std::string& name) const;
+        // Search this object and everything below it breadth first, so the shallowest member with the name wins and
+        // members at the same depth are found in document order. Unlike getValue every nested object and array is
+        // searched. On the root of a document parsed with ParseOptions::keyIndex the lookups go through an index of
+        // the whole document that is built on first use and rebuilt after the document changed.
+        Value* findValue(StringView name) const;
+        std::vector<Value*> findValues(StringView name) const;
 
-        void addValue(const std::string& name, std::unique_ptr<Value> value);
+        void addValue(StringView name, std::unique_ptr<Value> value);
 
         virtual void accept(ValueVisitor* visitor) const override;
     private:
-        std::map<std::string, std::unique_ptr<Value>> _values;
+        // declared before the values so it is destroyed after them
+        std::unique_ptr<detail::DocumentResources> _document;
+        detail::DocumentResources* _resources; // null for objects that are not part of a parsed document
+        detail::DocumentResources* _attachedTo; // the parsed document the object is in, also when added after parsing
+        // Maps the names to the slots of _values in insertion order. It is either shared through a ShapeTable or owned
+        // by this object, and null while the object is empty.
+        detail::Shape* _shape;
+        detail::ValueList _values;
+
+        detail::Arena* arena() const;
+        KeyTable* keys() const;
+        size_t findSlot(StringView name) const;
+        size_t findSlot(InternedKey key) const;
+        detail::Shape* ownShape();
+        const std::vector<Value*>* findIndexed(StringView name) const;
+        bool addMember(StringView name, std::unique_ptr<Value>& value); // false if the name is taken
+
+        friend void detail::destroyValues(detail::ValueList& values);
+        friend void detail::attachToDocument(Value* value, detail::DocumentResources* document);
     };
 
     class String : public Value {
     public:
-        String(const std::string& value);
+        String(std::string value);
+        String(StringView value, detail::Arena& arena); // the characters are copied into the arena
         std::string getValue() const;
+        StringView getStringView() const; // valid while the string is
 
         virtual void accept(ValueVisitor* visitor) const override;
     private:
         std::string _value;
+        StringView _arenaValue; // used instead of _value when the characters live in an arena
+        bool _inArena;
     };
 
     class Bool : public Value {
@@ -115,16 +466,71 @@ namespace json {
         virtual void accept(ValueVisitor* visitor) const override;
     };
 
+    /**
+     * Integers are stored exactly as 64 bit signed or unsigned integers. Everything else is a double.
+     */
     class Number : public Value {
     public:
         Number(double value);
+        Number(std::int64_t value);
+        Number(std::uint64_t value);
+
+        template <class T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, int>::type = 0>
+        Number(T value) : Number(static_cast<std::int64_t>(value)) {}
+
+        template <class T, typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value && !std::is_same<T, bool>::value, int>::type = 0>
+        Number(T value) : Number(static_cast<std::uint64_t>(value)) {}
+
+        bool isInteger() const;
+        bool isInt64() const;
+        bool isUint64() const;
+        bool isDouble() const;
+
         double getValue() const;
 
+        // Non integers are truncated and out of range values are clamped
+        std::int64_t getInt64Value() const;
+        std::uint64_t getUint64Value() const;
+
         virtual void accept(ValueVisitor* visitor) const override;
     private:
-        double _value;
+        enum class NumberType {
+            INT64,
+            UINT64,
+            DOUBLE
+        } _numberType;
+
+        union {
+            std::int64_t _int64;
+            std::uint64_t _uint64;
+            double _double;
+        };
     };
 
+    namespace detail {
+        struct ReclaimQueue;
+    }
+
+    /**
+     * Destroys values on a thread of its own, so the thread that is done with a large document can move on instead of
+     * waiting for every node of it to be freed. Values are destroyed in the order they were handed over.
+     */
+    class Reclaimer {
+    public:
+        Reclaimer();
+        ~Reclaimer(); // destroys whatever is still queued first
+        Reclaimer(const Reclaimer&) = delete;
+        Reclaimer& operator=(const Reclaimer&) = delete;
+
+        void reclaim(std::unique_ptr<Value> value);
+        void wait(); // until everything handed over so far is destroyed
+    private:
+        std::unique_ptr<detail::ReclaimQueue> _queue;
+    };
+
+    // Hands the value to a reclaimer shared by the whole process
+    void reclaimLater(std::unique_ptr<Value> value);
+
     namespace detail {
 
         enum class TokenType {
@@ -138,78 +544,711 @@ namespace json {
             JBOOL, // this name prevents macro collision with BOOL macro from WinAPI
             JNULL, // this name prevents macro collision with NULL macro
             NUMBER,
-            NONE
+            NONE,
+            INVALID // the lexer could not make a token out of the text, its failure tells why
+        };
+
+        // A decoded number without a Value around it, which the parsers turn into a json::Number
+        struct NumberLiteral {
+            enum class Kind { INT64, UINT64, DOUBLE } kind;
+            union {
+                std::int64_t int64;
+                std::uint64_t uint64;
+                double real;
+            };
+
+            NumberLiteral() : kind(Kind::DOUBLE), real(0.0) {}
         };
 
+        /**
+         * Tokens refer to the text they came from instead of copying it. The value of a string token is its
+         * contents without the quotes, and only strings with escapes are unescaped into a buffer of the lexer,
+         * which the next string with escapes reuses.
+         */
         struct Token {
             TokenType type;
-            std::string value;
+            StringView value;
+            size_t offset; // of the token's first character in the text
+            bool unescaped; // the value lives in the lexer's buffer rather than in the text
+            NumberLiteral number; // the decoded value of NUMBER tokens
+
+            Token(TokenType type = TokenType::NONE, StringView value = StringView(), size_t offset = 0);
+        };
+
+        // A 1 based line and column
+        struct TextPosition {
             int line;
             int pos;
+        };
+
+        // Counts the lines up to the offset, which is only worth doing for an error message
+        TextPosition getTextPosition(StringView text, size_t offset);
+
+        /**
+         * Everything needed to describe a parse error. Filling it in is cheap, the message is only formatted when
+         * someone asks for it.
+         */
+        struct ParseFailure {
+            ParseErrorCode code = ParseErrorCode::NONE;
+            size_t offset = 0; // in the text
+            const char* expected = ""; // what the lexer or parser was looking for
+            char found = '\0'; // the character the lexer found instead
+            StringView token; // the token the parser got instead
+            bool tokenUnescaped = false; // the token was copied to unescapedToken since the lexer reuses its buffer
+            std::string unescapedToken;
+            size_t maxDepth = 0;
+
+            std::string getMessage(StringView text) const;
+        };
 
-            Token(TokenType type = TokenType::NONE, const std::string& value = "", int line = 1, int pos = 1);
+        /**
+         * The offsets of every structural character ({}[]:,), every unescaped quote and the first character
+         * of every other token outside of strings. The text is classified 64 bytes at a time using SSE2/AVX2
+         * when available, so the lexer can jump between tokens instead of looking at every byte.
+         */
+        class StructuralIndex {
+        public:
+            StructuralIndex(StringView text);
+            const std::vector<std::uint32_t>& getPositions() const;
+        private:
+            std::vector<std::uint32_t> _positions;
         };
 
+        /**
+         * The lexer borrows the text it tokenizes, so the text must stay alive while the lexer is in use.
+         * When given a structural index of the same text, the lexer uses it to skip whitespace and string contents.
+         */
         class Lexer {
         public:
-            Lexer(const std::string& text);
-            Token getToken();
+            Lexer(StringView text, const StructuralIndex* index = nullptr);
+            Token getToken(); // throws a json::parse_exception when the text cannot be lexed
+            Token readToken(); // returns an INVALID token instead and leaves the reason in getFailure()
+            const ParseFailure& getFailure() const;
+
+            TextPosition getPosition(size_t offset) const;
         private:
             size_t _cursor;
-            std::string _text;
-            int _line;
-            int _pos;
+            StringView _text;
+            const StructuralIndex* _index;
+            size_t _structural;
 
-            enum NumberState { SIGN, DIGIT, DECIMAL, EXPONENT, EXPONENT_DIGIT, END };
+            std::string _unescaped; // the contents of the last string with escapes
+            ParseFailure _failure;
 
-            Lexer::NumberState processState(NumberState state, std::string& value);
+            void skipToStructural();
+            void jumpTo(size_t offset);
+            bool lexIndexedString(StringView& str);
 
             bool isDoneReading() const;
 
             bool isHexChar(char c);
-            std::string getHexDigits();
+            StringView getHexDigits();
             bool isWhitespaceControlChar(char n) const;
             bool isControlChar(char c) const;
             char getControlChar();
             Token lexString();
 
-            std::string lexValueSequence(const std::string& expected);
-            Token lexBool(const std::string& expected);
+            StringView lexValueSequence(StringView expected, const char* description);
+            Token lexBool(StringView expected);
             Token lexNull();
 
             Token lexNumber();
 
-            void raiseError(const std::string& expected);
+            Token fail(ParseErrorCode code, const char* expected = "");
+            bool failed() const;
 
             void skipWhitespace();
             char next();
             char curr();
             char peek();
 
-            Token reportToken(TokenType type, const std::string& str);
+            Token reportToken(TokenType type);
         };
 
-        class Parser {
+        /**
+         * Walks the grammar of a document in a loop over a stack of the open containers rather than by recursing, so
+         * the nesting of the input is only limited by maxDepth and not by the size of the call stack. The parsers derive
+         * from it and are called for what it finds:
+         *   void startContainer(bool isObject)
+         *   void endContainer(bool isObject, bool isRoot)
+         *   void key() - the name of the member to come is the current token
+         *   bool scalar() - the current token, false stops the walk
+         */
+        template <class Derived>
+        class DocumentWalker {
         public:
-            std::unique_ptr<Object> parse();
-            Parser(Lexer lexer);
-        private:
+            const ParseFailure& getFailure() const;
+        protected:
+            DocumentWalker(Lexer lexer, size_t maxDepth) : lexer(lexer), maxDepth(maxDepth) {}
+
+            bool walk(); // false when the text is malformed, getFailure() tells why
+            void fail(const char* expected);
+
             Lexer lexer;
             Token currentToken;
+            size_t maxDepth;
+            std::vector<bool> open; // whether each open container is an object
+            ParseFailure failure;
+        };
+
+        /**
+         * Builds the DOM out of what the DocumentWalker finds.
+         */
+        class Parser : public DocumentWalker<Parser> {
+        public:
+            std::unique_ptr<Object> parse(); // null when the text is malformed, getFailure() tells why
+            Parser(Lexer lexer, std::unique_ptr<DocumentResources> resources = nullptr, size_t maxDepth = 1024);
+            ~Parser();
+        private:
+            struct Level {
+                std::unique_ptr<Value> container;
+                bool nameUnescaped; // the name is kept in unescapedName since the lexer reuses its buffer
+                StringView name; // of the member being parsed when the container is an object
+                std::string unescapedName;
+
+                StringView getName() const { return nameUnescaped ? StringView(unescapedName) : name; }
+            };
+
+            std::unique_ptr<DocumentResources> document; // handed to the root object
+            DocumentResources* resources;
+            Arena* arena;
+            std::vector<Level> levels;
+            std::unique_ptr<Object> root; // once its closing brace was read
+
+            template <class T, class... Args>
+            std::unique_ptr<T> create(Args&&... args);
+            std::unique_ptr<Object> createObject();
+            void addValue(std::unique_ptr<Value> value);
+
+            void startContainer(bool isObject);
+            void endContainer(bool isObject, bool isRoot);
+            void key();
+            bool scalar();
+
+            friend class DocumentWalker<Parser>;
+        };
+
+        /**
+         * Reports what the DocumentWalker finds to a handler instead of building a DOM.
+         */
+        class EventParser : public DocumentWalker<EventParser> {
+        public:
+            bool parse(); // false when the text is malformed, getFailure() tells why
+            EventParser(Lexer lexer, ParseHandler* handler, size_t maxDepth = 1024);
+        private:
+            ParseHandler* handler;
+
+            void startContainer(bool isObject);
+            void endContainer(bool isObject, bool isRoot);
+            void key();
+            bool scalar();
 
-            std::unique_ptr<Object> parseObject();
-            std::unique_ptr<Value> parseValue();
-            std::unique_ptr<Array> parseArray();
-            std::unique_ptr<Object> parseValueList();
-            void raiseError(const std::string& expected);
+            friend class DocumentWalker<EventParser>;
         };
+
     }
 
     std::unique_ptr<Object> load(const std::string& filePath);
     
     void write(const Object* obj, const std::string& filePath);
+    void write(const Object* obj, std::ostream& stream);
+
+    struct ParseOptions {
+        // Find all of the structural characters in a vectorized first pass before parsing.
+        // This pays off on large documents, particularly ones made up mostly of strings.
+        bool structuralIndex = false;
+        // Allocate the whole DOM, including keys and strings, from an arena owned by the returned object.
+        // Building and destroying the DOM then takes a handful of allocations instead of several per value.
+        bool arena = false;
+        // Intern object keys in this table, which may be shared by many documents and threads. The parsed documents
+        // keep the table alive.
+        std::shared_ptr<KeyTable> keys;
+        // Share the layouts of objects with the same keys through this table, which may be shared by many documents and
+        // threads. Keys are then interned in the shape table's key table instead of the one above.
+        std::shared_ptr<ShapeTable> shapes;
+        // Make Object::findValue on the returned object an O(1) lookup through an index of every key in the document.
+        // The index is built by the first lookup and again by the first lookup after the document was changed.
+        bool keyIndex = false;
+        // Documents with more objects and arrays nested inside each other than this are rejected, by parse with a
+        // json::parse_exception and by tryParse with ParseErrorCode::TOO_DEEP. This keeps hostile input from building
+        // values that are expensive to walk.
+        size_t maxDepth = 1024;
+    };
+
+    /**
+     * Parses the text in place without copying it. The text only needs to stay alive for the duration of the call.
+     */
+    std::unique_ptr<Object> parse(StringView text);
+    std::unique_ptr<Object> parse(StringView text, const ParseOptions& options);
+
+    /**
+     * What tryParse returns. Parsing only notes what went wrong and where, the message is formatted by getMessage.
+     */
+    struct ParseResult {
+        std::unique_ptr<Object> object; // null if the text could not be parsed
+        ParseErrorCode error = ParseErrorCode::NONE;
+        size_t offset = 0; // of the error in the text
+
+        // The message parse would have thrown. The parsed text has to still be alive.
+        std::string getMessage() const;
+    private:
+        StringView _text;
+        detail::ParseFailure _failure;
+
+        friend ParseResult tryParse(StringView text, const ParseOptions& options) noexcept;
+    };
+
+    /**
+     * Parses like parse but reports malformed text through the result instead of throwing, so rejecting bad input
+     * costs about as much as parsing good input. Running out of memory is reported as an error as well.
+     */
+    ParseResult tryParse(StringView text, const ParseOptions& options = ParseOptions()) noexcept;
+
+    /**
+     * Receives the contents of a document as it is parsed, in document order. Every event does nothing by default
+     * so a handler only needs to override the events it cares about. Keys and strings are only valid during the call.
+     */
+    struct ParseHandler {
+        virtual ~ParseHandler() {}
+
+        virtual void startObject() {}
+        virtual void key(StringView) {}
+        virtual void endObject() {}
+        virtual void startArray() {}
+        virtual void endArray() {}
+        virtual void string(StringView) {}
+        virtual void number(const Number&) {}
+        virtual void boolean(bool) {}
+        virtual void null() {}
+    };
+
+    /**
+     * Parses the text and reports it to the handler without building a DOM. Malformed text throws a
+     * json::parse_exception, possibly after some events have already been reported.
+     */
+    void parse(StringView text, ParseHandler* handler);
+    void parse(StringView text, ParseHandler* handler, const ParseOptions& options);
+
+    /**
+     * The outcome of parsing one line of newline delimited JSON (NDJSON / JSON Lines).
+     */
+    struct LineResult {
+        size_t line; // 1 based line number in the input
+        std::unique_ptr<Object> object; // null if the line could not be parsed
+        std::string error; // why the line could not be parsed
+    };
+
+    struct LineOptions {
+        // The number of threads parsing lines, 0 uses one per hardware thread
+        size_t threads = 0;
+        // Deliver the results in line order, otherwise they are delivered as soon as they are ready
+        bool ordered = true;
+        // Roughly how many bytes of lines a thread parses before handing the results back
+        size_t batchSize = 256 * 1024;
+        ParseOptions parseOptions;
+    };
+
+    /**
+     * Parses every non blank line of the text as its own document on a pool of threads. A malformed line only fails that
+     * line. The callback is always called on the calling thread, one result at a time.
+     */
+    void parseLines(StringView text, const std::function<void(LineResult&)>& callback, const LineOptions& options = LineOptions());
+    void loadLines(const std::string& filePath, const std::function<void(LineResult&)>& callback, const LineOptions& options = LineOptions());
+
+    /**
+     * A handler that builds a DOM out of the events it receives, e.g. to get a DOM out of a PushParser.
+     */
+    class DocumentBuilder : public ParseHandler {
+    public:
+        virtual void startObject() override;
+        virtual void key(StringView name) override;
+        virtual void endObject() override;
+        virtual void startArray() override;
+        virtual void endArray() override;
+        virtual void string(StringView value) override;
+        virtual void number(const Number& value) override;
+        virtual void boolean(bool value) override;
+        virtual void null() override;
+
+        // Hands over the document once its closing brace was received, otherwise returns null
+        std::unique_ptr<Object> release();
+    private:
+        struct Level {
+            std::unique_ptr<Value> container;
+            std::string key; // the name the next value is added under when the container is an object
+        };
+        std::vector<Level> _levels;
+        std::unique_ptr<Object> _document;
+
+        void addValue(std::unique_ptr<Value> value);
+    };
+
+    class Document;
+    class ObjectView;
+    class ArrayView;
+
+    namespace detail {
+
+        // The type of a tape entry, stored in its top byte
+        enum class TapeType : std::uint8_t {
+            OBJECT_START,
+            OBJECT_END,
+            ARRAY_START,
+            ARRAY_END,
+            STRING,
+            INT64,
+            UINT64,
+            DOUBLE,
+            TRUE_VALUE,
+            FALSE_VALUE,
+            NULL_VALUE
+        };
+    }
+
+    /**
+     * A cursor to a value of a Document. Views are two words big, cheap to copy and only valid while their document is.
+     * A default constructed view refers to nothing and converts to false.
+     */
+    class ValueView {
+    public:
+        ValueView() : _document(nullptr), _index(0) {}
+
+        explicit operator bool() const { return _document != nullptr; }
+
+        bool isObject() const;
+        bool isArray() const;
+        bool isString() const;
+        bool isNumber() const;
+        bool isBool() const;
+        bool isNull() const;
+        bool isInteger() const; // a number stored exactly as a 64 bit integer, like json::Number::isInteger
+
+        // The conversions return an empty view or the default value when the view refers to a value of a different type
+        ObjectView asObject() const;
+        ArrayView asArray() const;
+        StringView asString(StringView defaultValue = StringView()) const;
+        bool asBool(bool defaultValue = false) const;
+        double asNumber(double defaultValue = 0.0) const;
+        std::int64_t asInt64(std::int64_t defaultValue = 0) const;
+        std::uint64_t asUint64(std::uint64_t defaultValue = 0) const;
+    protected:
+        ValueView(const Document* document, size_t index) : _document(document), _index(index) {}
+
+        const Document* _document;
+        size_t _index; // of the value's first entry on the tape
+
+        friend class Document;
+        friend class ObjectView;
+        friend class ArrayView;
+    };
+
+    /**
+     * A view of an object of a Document. Members are kept in document order, and like json::Object the first member
+     * with a given name wins and names that are not found are looked up in the first nested object.
+     */
+    class ObjectView : public ValueView {
+    public:
+        struct Member {
+            StringView name;
+            ValueView value;
+        };
+
+        class Iterator {
+        public:
+            Iterator(const Document* document, size_t index) : _document(document), _index(index) {}
+
+            Member operator*() const;
+            Iterator& operator++();
+            bool operator==(const Iterator& other) const { return _index == other._index; }
+            bool operator!=(const Iterator& other) const { return _index != other._index; }
+        private:
+            const Document* _document;
+            size_t _index; // of the member's name on the tape
+        };
+
+        ObjectView() {}
+
+        size_t size() const;
+        Iterator begin() const;
+        Iterator end() const;
+
+        ValueView getValue(StringView name) const;
+        ObjectView getObjectValue(StringView name) const;
+        ArrayView getArrayValue(StringView name) const;
+
+        StringView getStringValue(StringView name, StringView defaultValue = StringView()) const;
+        bool getBoolValue(StringView name, bool defaultValue = false) const;
+        double getNumberValue(StringView name, double defaultValue = 0.0) const;
+        std::int64_t getInt64Value(StringView name, std::int64_t defaultValue = 0) const;
+        std::uint64_t getUint64Value(StringView name, std::uint64_t defaultValue = 0) const;
+    private:
+        ObjectView(const Document* document, size_t index) : ValueView(document, index) {}
+
+        friend class ValueView;
+    };
+
+    /**
+     * A view of an array of a Document. Iterating is the fast way through an array, getValue walks from the start.
+     */
+    class ArrayView : public ValueView {
+    public:
+        class Iterator {
+        public:
+            Iterator(const Document* document, size_t index) : _document(document), _index(index) {}
+
+            ValueView operator*() const;
+            Iterator& operator++();
+            bool operator==(const Iterator& other) const { return _index == other._index; }
+            bool operator!=(const Iterator& other) const { return _index != other._index; }
+        private:
+            const Document* _document;
+            size_t _index;
+        };
 
-    std::unique_ptr<Object> parse(const std::string& text);
+        ArrayView() {}
+
+        size_t size() const;
+        Iterator begin() const;
+        Iterator end() const;
+
+        ValueView getValue(size_t index) const;
+        ObjectView getObjectValue(size_t index) const;
+        ArrayView getArrayValue(size_t index) const;
+
+        StringView getStringValue(size_t index, StringView defaultValue = StringView()) const;
+        bool getBoolValue(size_t index, bool defaultValue = false) const;
+        double getNumberValue(size_t index, double defaultValue = 0.0) const;
+        std::int64_t getInt64Value(size_t index, std::int64_t defaultValue = 0) const;
+        std::uint64_t getUint64Value(size_t index, std::uint64_t defaultValue = 0) const;
+    private:
+        ArrayView(const Document* document, size_t index) : ValueView(document, index) {}
+
+        friend class ValueView;
+    };
+
+    /**
+     * A read only document stored as one contiguous tape of 64 bit entries with the string characters in a side buffer,
+     * instead of a tree of separately allocated values. It takes a fraction of the memory of the equivalent DOM and
+     * scanning it touches memory front to back. Read it through the views returned by getRoot.
+     *
+     * Every scalar takes one entry, except numbers whose value is stored in a second entry. An object or array takes
+     * an entry at each end, the start knows where the end is so a container is skipped in one step.
+     */
+    class Document {
+    public:
+        ObjectView getRoot() const; // an empty view when the document is default constructed or was moved from
+
+        // The number of bytes taken by the tape and the strings
+        size_t getMemoryUsage() const;
+    private:
+        std::vector<std::uint64_t> _tape;
+        std::vector<char> _strings; // every string is preceded by its 32 bit length
+
+        friend class TapeBuilder;
+        friend class ValueView;
+        friend class ObjectView;
+        friend class ArrayView;
+    };
+
+    /**
+     * Parses the text into a Document. Malformed text throws a json::parse_exception.
+     */
+    Document parseDocument(StringView text);
+    Document parseDocument(StringView text, const ParseOptions& options);
+
+    /**
+     * A handler that builds a Document out of the events it receives, e.g. to get a Document out of a PushParser.
+     */
+    class TapeBuilder : public ParseHandler {
+    public:
+        virtual void startObject() override;
+        virtual void key(StringView name) override;
+        virtual void endObject() override;
+        virtual void startArray() override;
+        virtual void endArray() override;
+        virtual void string(StringView value) override;
+        virtual void number(const Number& value) override;
+        virtual void boolean(bool value) override;
+        virtual void null() override;
+
+        // Hands over the document once its closing brace was received, otherwise throws a json::parse_exception
+        Document release();
+    private:
+        struct Container {
+            size_t start; // the index of the start entry
+            size_t size;
+            size_t firstName; // of an object's names in _names
+        };
+        Document _document;
+        std::vector<Container> _open;
+        bool _complete = false;
+
+        // Like json::Object the first member with a given name wins, so later ones are left off the tape
+        struct Name {
+            size_t index; // on the tape
+            std::uint32_t hash;
+        };
+        std::vector<Name> _names; // of the open objects
+        std::multimap<std::uint64_t, size_t> _nameIndex; // the start of a large object and a name's hash to the name's index
+        bool _skipping = false; // the events are of the value of a member that is left off
+        size_t _skipDepth = 0; // of the containers open in that value
+
+        bool skip(bool start, bool end);
+        bool isDuplicate(StringView name, std::uint32_t hash);
+        void addName();
+        void addValue();
+        void add(detail::TapeType type, std::uint64_t payload = 0);
+        void startContainer(detail::TapeType type);
+        void endContainer(detail::TapeType start, detail::TapeType end);
+        void addString(StringView value);
+    };
+
+    namespace detail {
+
+        // [?(@.a.b)] or [?(@.a.b <op> literal)]
+        struct PathFilter {
+            enum class Op { EXISTS, EQ, NE, LT, LE, GT, GE } op = Op::EXISTS;
+            enum class Type { STRING, NUMBER, BOOL, JNULL } type = Type::JNULL;
+            std::vector<std::string> names; // the path from @ to the compared member
+            std::string string;
+            NumberLiteral number; // integers are kept exact, so they compare exactly with integers of a document
+            bool boolean = false;
+        };
+
+        struct PathStep {
+            enum class Kind {
+                CHILD, // .name or ['name']
+                INDEX, // [n]
+                WILDCARD, // .* or [*]
+                DESCENDANT, // the .. in front of another step, which then applies at any depth
+                FILTER // [?(...)]
+            } kind;
+            std::string name;
+            size_t index = 0;
+            PathFilter filter;
+        };
+
+        class ValueCapture;
+    }
+
+    /**
+     * A JSONPath expression compiled once into a plan that can be run against any number of documents, as a DOM, as a
+     * tape Document, or straight from the text without building either. The supported subset is the root $, children
+     * .name and ['name'], array indexes [n], wildcards .* and [*], descendants ..name and ..*, and filters on the
+     * children of a node such as [?(@.price < 10)], [?(@.kind == 'book')] or [?(@.isbn)].
+     * Malformed expressions throw a json::parse_exception.
+     */
+    class Path {
+    public:
+        Path(StringView expression);
+
+        // The matches in the order the plan finds them, descendants in document order
+        std::vector<Value*> select(const Value* root) const;
+        std::vector<ValueView> select(ValueView root) const;
+
+        // Parses the text and reports every match as soon as it ends, only building the matched values. A match is
+        // therefore reported after the matches inside it, and the value is only valid during the call.
+        void stream(StringView text, const std::function<void(const Value&)>& callback) const;
+    private:
+        std::vector<detail::PathStep> _steps;
+
+        friend class PathHandler;
+    };
+
+    /**
+     * A handler that reports the matches of a Path out of the events it receives, e.g. to run a query over a PushParser.
+     */
+    class PathHandler : public ParseHandler {
+    public:
+        PathHandler(const Path& path, std::function<void(const Value&)> callback);
+        ~PathHandler();
+
+        virtual void startObject() override;
+        virtual void key(StringView name) override;
+        virtual void endObject() override;
+        virtual void startArray() override;
+        virtual void endArray() override;
+        virtual void string(StringView value) override;
+        virtual void number(const Number& value) override;
+        virtual void boolean(bool value) override;
+        virtual void null() override;
+    private:
+        struct Frame {
+            std::vector<size_t> states; // the steps that apply to the children of the container
+            bool array;
+            size_t nextIndex;
+            std::string key;
+        };
+
+        // A value that is reported or filtered once it ends
+        struct Capture {
+            size_t continuation; // the step the finished value is matched from, the number of steps for a match
+            size_t depth; // of the capture's containers when the value started
+        };
+
+        std::vector<detail::PathStep> _steps;
+        std::function<void(const Value&)> _callback;
+        std::vector<Frame> _frames;
+        std::unique_ptr<detail::ValueCapture> _capture; // builds the outermost captured value, the others are inside it
+        std::vector<Capture> _captures; // innermost last
+
+        void startValue(bool container, const std::function<std::unique_ptr<Value>()>& create);
+        void endValue(std::unique_ptr<Value> value);
+        void endContainer();
+        void finish(const Capture& capture, const Value& value);
+    };
+
+    /**
+     * Parses a document that arrives in pieces, e.g. from a socket. Every call to feed reports the events that the new
+     * characters complete to the handler. Everything in between is remembered, so a piece may end anywhere, including
+     * in the middle of a string, an escape sequence or a number. Malformed text, and objects and arrays nested deeper
+     * than maxDepth, throw a json::parse_exception.
+     */
+    class PushParser {
+    public:
+        PushParser(ParseHandler* handler, size_t maxDepth = 1024);
+
+        // Returns how many characters were consumed, which is less than size only if the document ended part way through
+        size_t feed(const char* data, size_t size);
+
+        // Signals the end of the input. Throws a json::parse_exception if the document is incomplete.
+        void finish();
+
+        bool isComplete() const;
+    private:
+        enum class LexState { NONE, STRING, STRING_ESCAPE, STRING_UNICODE, NUMBER, LITERAL };
+        enum class ParseState { ROOT, FIRST_KEY, KEY, COLON, VALUE, FIRST_VALUE, AFTER_VALUE, DONE };
+        enum class NumberState { SIGN, INTEGER, FRACTION_START, FRACTION, EXPONENT_START, EXPONENT_SIGN, EXPONENT };
+
+        ParseHandler* _handler;
+        size_t _maxDepth;
+        LexState _lexState;
+        ParseState _parseState;
+        NumberState _numberState;
+        std::vector<bool> _inObject; // one entry per open container
+        std::string _token; // the text of the token being lexed
+        const char* _literal;
+        detail::TokenType _literalType;
+        int _unicodeDigits;
+        std::uint32_t _unicodeValue;
+        std::uint32_t _highSurrogate; // of a pair whose low half has not been read yet, 0 if none
+        int _line;
+        int _pos;
+        int _tokenLine;
+        int _tokenPos;
+
+        bool advanceNumber(char c);
+        void finishNumber();
+        void startToken(char c);
+        void token(detail::TokenType type, const Number* number = nullptr);
+        void scalar(detail::TokenType type, const Number* number);
+        void endValue();
+        void openContainer(bool isObject);
+        void addCodeUnit(std::uint32_t unit);
+        void flushSurrogate();
+        void raiseLexError(const std::string& expected, char found);
+        void raiseError(const std::string& expected);
+    };
 
     struct ValueVisitor {
         virtual ~ValueVisitor() {}
@@ -222,8 +1261,48 @@ namespace json {
         virtual void visit(const Number* obj) = 0;
     };
 
+    /**
+     * Writes values through a fixed size buffer that is handed to a sink whenever it fills up, so the memory it takes
+     * does not depend on the size of the document. The sink is a function, a std::ostream or a file descriptor.
+     * Call flush once done to hand over the rest of the buffer. Sinks that fail throw a std::runtime_error.
+     */
+    class StreamWriter : public ValueVisitor {
+    public:
+        static const size_t DEFAULT_BUFFER_SIZE;
+
+        StreamWriter(std::function<void(const char* data, size_t size)> sink, size_t bufferSize = DEFAULT_BUFFER_SIZE);
+        StreamWriter(std::ostream& stream, size_t bufferSize = DEFAULT_BUFFER_SIZE);
+        StreamWriter(int fileDescriptor, size_t bufferSize = DEFAULT_BUFFER_SIZE);
+
+        virtual void visit(const Object* obj) override;
+        virtual void visit(const Array* obj) override;
+        virtual void visit(const String* obj) override;
+        virtual void visit(const Bool* obj) override;
+        virtual void visit(const Null* obj) override;
+        virtual void visit(const Number* obj) override;
+
+        void flush();
+    private:
+        std::function<void(const char*, size_t)> _sink;
+        std::vector<char> _buffer;
+        size_t _size; // of the buffered output
+
+        void put(char c);
+        void put(const char* data, size_t size);
+        void putString(StringView str); // quoted and escaped
+    };
+
+    /**
+     * Writes values into a string.
+     */
     class ValueWriter : public ValueVisitor {
     public:
+        ValueWriter();
+        ValueWriter(const ValueWriter& other);
+        ValueWriter(ValueWriter&& other);
+        ValueWriter& operator=(const ValueWriter& other);
+        ValueWriter& operator=(ValueWriter&& other);
+
         virtual void visit(const Object* obj) override;
         virtual void visit(const Array* obj) override;
         virtual void visit(const String* obj) override;
@@ -234,5 +1313,6 @@ namespace json {
         std::string getString() const;
     private:
         std::string _str;
+        StreamWriter _writer; // appends to this _str, flushed after every value so copies only take the string
     };
 }
\ No newline at end of file
@@ -70,9 +70,19 @@ void report(const std::string& name)
 
     constexpr size_t reps = 10;
     auto text = readFile(name);
-    auto totalTime = repeat<std::chrono::steady_clock, std::chrono::microseconds>(reps, json::parse, text);
+    auto totalTime = repeat<std::chrono::steady_clock, std::chrono::microseconds>(reps, [](const std::string& t) { json::parse(t); }, text);
     
     std::cout << "After parsing " << reps << " times, it took an average of " << totalTime / reps << " us " << (totalTime / 1000) / reps << " ms to parse " << name << ".\n";
+
+    json::ParseOptions indexed;
+    indexed.structuralIndex = true;
+    totalTime = repeat<std::chrono::steady_clock, std::chrono::microseconds>(reps, [&](const std::string& t) { json::parse(t, indexed); }, text);
+
+    std::cout << "With a structural index, it took an average of " << totalTime / reps << " us " << (totalTime / 1000) / reps << " ms to parse " << name << ".\n";
+
+    totalTime = repeat<std::chrono::steady_clock, std::chrono::microseconds>(reps, [](const std::string& t) { json::parseDocument(t); }, text);
+
+    std::cout << "Into a tape document, it took an average of " << totalTime / reps << " us " << (totalTime / 1000) / reps << " ms to parse " << name << ".\n";
 }
 
 int main()
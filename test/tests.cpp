@@ -1,7 +1,12 @@
 #define CATCH_CONFIG_MAIN
 #include "test/catch.hpp"
 #include "jsonpp.hpp"
+#include <atomic>
+#include <cstdlib>
 #include <fstream>
+#include <new>
+#include <sstream>
+#include <thread>
 
 #define JSONPP_DOUBLE_EQUALS(obj, name, expected) do {\
     auto target = Approx((expected)).epsilon(std::numeric_limits<double>::epsilon() * 100);\
@@ -244,6 +249,21 @@ TEST_CASE("TestLexingStringMissingTerminatorThrows")
     REQUIRE_THROWS_AS(lexer.getToken(), json::parse_exception);
 }
 
+TEST_CASE("TestParsingStringViewDoesNotReadPastTheView")
+{
+    std::string buffer = R"({ "foo" : 12 }{ "bar" : 34 })";
+    auto obj = json::parse(json::StringView(buffer.data(), 14));
+    JSONPP_DOUBLE_EQUALS(obj, "foo", 12);
+    REQUIRE(obj->getValue("bar") == nullptr);
+}
+
+TEST_CASE("TestLexingUnterminatedStringView")
+{
+    std::string buffer = R"("foo" : "bar")";
+    json::detail::Lexer lexer(json::StringView(buffer.data(), 3));
+    REQUIRE_THROWS_AS(lexer.getToken(), json::parse_exception);
+}
+
 TEST_CASE("TestStringValue")
 {
     auto value = std::make_unique<json::String>("foo");
@@ -302,8 +322,8 @@ TEST_CASE("TestLexBoolTrue")
 {
     json::detail::Lexer lexer("true");
     auto token = lexer.getToken();
-    REQUIRE(token.line == 1);
-    REQUIRE(token.pos == 1);
+    REQUIRE(lexer.getPosition(token.offset).line == 1);
+    REQUIRE(lexer.getPosition(token.offset).pos == 1);
     REQUIRE(token.value == "true");
     REQUIRE(token.type == json::detail::TokenType::JBOOL);
 }
@@ -312,8 +332,8 @@ TEST_CASE("TestLexBoolFalse")
 {
     json::detail::Lexer lexer("false");
     auto token = lexer.getToken();
-    REQUIRE(token.line == 1);
-    REQUIRE(token.pos == 1);
+    REQUIRE(lexer.getPosition(token.offset).line == 1);
+    REQUIRE(lexer.getPosition(token.offset).pos == 1);
     REQUIRE(token.value == "false");
     REQUIRE(token.type == json::detail::TokenType::JBOOL);
 }
@@ -334,8 +354,8 @@ TEST_CASE("TestLexNull")
 {
     json::detail::Lexer lexer("null");
     auto token = lexer.getToken();
-    REQUIRE(token.line == 1);
-    REQUIRE(token.pos == 1);
+    REQUIRE(lexer.getPosition(token.offset).line == 1);
+    REQUIRE(lexer.getPosition(token.offset).pos == 1);
     REQUIRE(token.value == "null");
     REQUIRE(token.type == json::detail::TokenType::JNULL);
 }
@@ -473,6 +493,45 @@ TEST_CASE("TestParseNumberWithNonDigit")
     REQUIRE_THROWS_AS(json::parse(text), json::parse_exception);
 }
 
+TEST_CASE("TestParseNumberWithExponentAndNoDecimal")
+{
+    std::string text =
+    R"({
+        "foo" : 12345e2,
+        "bar" : -5E-1
+    })";
+    auto obj = json::parse(text);
+    REQUIRE(obj->getNumberValue("foo") == 1234500.0);
+    REQUIRE(obj->getNumberValue("bar") == -0.5);
+}
+
+TEST_CASE("TestParseNumberIsCorrectlyRounded")
+{
+    std::string text =
+    R"({
+        "a" : 0.1,
+        "b" : 2.2250738585072011e-308,
+        "c" : 4.9e-324,
+        "d" : 123456789012345678901234567890,
+        "e" : 1.7976931348623157e308,
+        "f" : 0.000000000000000000000000000001234567890123456789012345
+    })";
+    auto obj = json::parse(text);
+    REQUIRE(obj->getNumberValue("a") == 0.1);
+    REQUIRE(obj->getNumberValue("b") == 2.2250738585072011e-308);
+    REQUIRE(obj->getNumberValue("c") == 4.9e-324);
+    REQUIRE(obj->getNumberValue("d") == 123456789012345678901234567890.0);
+    REQUIRE(obj->getNumberValue("e") == 1.7976931348623157e308);
+    REQUIRE(obj->getNumberValue("f") == 0.000000000000000000000000000001234567890123456789012345);
+}
+
+TEST_CASE("TestParseNumberMissingDigitsThrows")
+{
+    REQUIRE_THROWS_AS(json::parse(R"({ "foo" : - })"), json::parse_exception);
+    REQUIRE_THROWS_AS(json::parse(R"({ "foo" : 1. })"), json::parse_exception);
+    REQUIRE_THROWS_AS(json::parse(R"({ "foo" : 1e+ })"), json::parse_exception);
+}
+
 TEST_CASE("TestLexingJSONForPositionAndLineNumber")
 {
     std::string text =
@@ -486,68 +545,68 @@ TEST_CASE("TestLexingJSONForPositionAndLineNumber")
     
     auto tok = lexer.getToken();
     REQUIRE(tok.value == "{");
-    REQUIRE(tok.line == 1);
-    REQUIRE(tok.pos == 1);
+    REQUIRE(lexer.getPosition(tok.offset).line == 1);
+    REQUIRE(lexer.getPosition(tok.offset).pos == 1);
 
     tok = lexer.getToken();
     REQUIRE(tok.value == "foo");
-    REQUIRE(tok.line == 2);
-    REQUIRE(tok.pos == 5);
+    REQUIRE(lexer.getPosition(tok.offset).line == 2);
+    REQUIRE(lexer.getPosition(tok.offset).pos == 5);
 
     tok = lexer.getToken();
     REQUIRE(tok.value == ":");
-    REQUIRE(tok.line == 2);
-    REQUIRE(tok.pos == 11);
+    REQUIRE(lexer.getPosition(tok.offset).line == 2);
+    REQUIRE(lexer.getPosition(tok.offset).pos == 11);
 
     tok = lexer.getToken();
     REQUIRE(tok.value == "bar");
-    REQUIRE(tok.line == 2);
-    REQUIRE(tok.pos == 13);
+    REQUIRE(lexer.getPosition(tok.offset).line == 2);
+    REQUIRE(lexer.getPosition(tok.offset).pos == 13);
 
     tok = lexer.getToken();
     REQUIRE(tok.value == ",");
-    REQUIRE(tok.line == 2);
-    REQUIRE(tok.pos == 18);
+    REQUIRE(lexer.getPosition(tok.offset).line == 2);
+    REQUIRE(lexer.getPosition(tok.offset).pos == 18);
 
     tok = lexer.getToken();
     REQUIRE(tok.value == "baz");
-    REQUIRE(tok.line == 3);
-    REQUIRE(tok.pos == 5);
+    REQUIRE(lexer.getPosition(tok.offset).line == 3);
+    REQUIRE(lexer.getPosition(tok.offset).pos == 5);
 
     tok = lexer.getToken();
     REQUIRE(tok.value == ":");
-    REQUIRE(tok.line == 3);
-    REQUIRE(tok.pos == 11);
+    REQUIRE(lexer.getPosition(tok.offset).line == 3);
+    REQUIRE(lexer.getPosition(tok.offset).pos == 11);
 
     tok = lexer.getToken();
     REQUIRE(tok.value == "true");
-    REQUIRE(tok.line == 3);
-    REQUIRE(tok.pos == 13);
+    REQUIRE(lexer.getPosition(tok.offset).line == 3);
+    REQUIRE(lexer.getPosition(tok.offset).pos == 13);
 
     tok = lexer.getToken();
     REQUIRE(tok.value == ",");
-    REQUIRE(tok.line == 3);
-    REQUIRE(tok.pos == 17);
+    REQUIRE(lexer.getPosition(tok.offset).line == 3);
+    REQUIRE(lexer.getPosition(tok.offset).pos == 17);
 
     tok = lexer.getToken();
     REQUIRE(tok.value == "abc");
-    REQUIRE(tok.line == 4);
-    REQUIRE(tok.pos == 5);
+    REQUIRE(lexer.getPosition(tok.offset).line == 4);
+    REQUIRE(lexer.getPosition(tok.offset).pos == 5);
 
     tok = lexer.getToken();
     REQUIRE(tok.value == ":");
-    REQUIRE(tok.line == 4);
-    REQUIRE(tok.pos == 11);
+    REQUIRE(lexer.getPosition(tok.offset).line == 4);
+    REQUIRE(lexer.getPosition(tok.offset).pos == 11);
 
     tok = lexer.getToken();
     REQUIRE(tok.value == "123");
-    REQUIRE(tok.line == 4);
-    REQUIRE(tok.pos == 13);
+    REQUIRE(lexer.getPosition(tok.offset).line == 4);
+    REQUIRE(lexer.getPosition(tok.offset).pos == 13);
 
     tok = lexer.getToken();
     REQUIRE(tok.value == "}");
-    REQUIRE(tok.line == 5);
-    REQUIRE(tok.pos == 5);
+    REQUIRE(lexer.getPosition(tok.offset).line == 5);
+    REQUIRE(lexer.getPosition(tok.offset).pos == 5);
 }
 
 TEST_CASE("TestParseInnerQuoteMarkString")
@@ -591,7 +650,7 @@ TEST_CASE("TestParseBackspace")
     })";
 
     auto obj = json::parse(text);
-    REQUIRE(obj->getStringValue("foo") == R"(b\bar)");
+    REQUIRE(obj->getStringValue("foo") == "b\bar");
 }
 
 TEST_CASE("TestParseFormfeed")
@@ -602,7 +661,7 @@ TEST_CASE("TestParseFormfeed")
     })";
 
     auto obj = json::parse(text);
-    REQUIRE(obj->getStringValue("foo") == R"(b\far)");
+    REQUIRE(obj->getStringValue("foo") == "b\far");
 }
 
 TEST_CASE("TestParseNewLine")
@@ -613,7 +672,7 @@ TEST_CASE("TestParseNewLine")
     })";
 
     auto obj = json::parse(text);
-    REQUIRE(obj->getStringValue("foo") == R"(b\nar)");
+    REQUIRE(obj->getStringValue("foo") == "b\nar");
 }
 
 TEST_CASE("TestParseCarriageReturn")
@@ -624,7 +683,7 @@ TEST_CASE("TestParseCarriageReturn")
     })";
 
     auto obj = json::parse(text);
-    REQUIRE(obj->getStringValue("foo") == R"(b\rar)");
+    REQUIRE(obj->getStringValue("foo") == "b\rar");
 }
 
 TEST_CASE("TestParseTab")
@@ -635,7 +694,7 @@ TEST_CASE("TestParseTab")
     })";
 
     auto obj = json::parse(text);
-    REQUIRE(obj->getStringValue("foo") == R"(b\tar)");
+    REQUIRE(obj->getStringValue("foo") == "b\tar");
 }
 
 TEST_CASE("TestParseUControl")
@@ -646,7 +705,7 @@ TEST_CASE("TestParseUControl")
     })";
 
     auto obj = json::parse(text);
-    REQUIRE(obj->getStringValue("foo") == "DEAD");
+    REQUIRE(obj->getStringValue("foo") == "\xEF\xBF\xBD"); // a lone surrogate becomes U+FFFD
 }
 
 TEST_CASE("TestParseUControlWithLessThan4HexadecimalDigits")
@@ -791,4 +850,1440 @@ TEST_CASE("TestWriteJSONRoundTrip")
         REQUIRE(values2[i]->isNumber());
         REQUIRE(static_cast<json::Number*>(values[i])->getValue() == static_cast<json::Number*>(values2[i])->getValue());
     }
-}
\ No newline at end of file
+}
+static std::string writeToString(const json::Value* value)
+{
+    json::ValueWriter writer;
+    value->accept(&writer);
+    return writer.getString();
+}
+
+static json::ParseOptions indexedOptions()
+{
+    json::ParseOptions options;
+    options.structuralIndex = true;
+    return options;
+}
+
+TEST_CASE("TestStructuralIndexMatchesRegularParsing")
+{
+    for (auto text : { DB_JSON, GOOGLE_MARKERS_JSON, YOUTUBE_SEARCH_JSON }) {
+        auto expected = json::parse(text);
+        auto actual = json::parse(text, indexedOptions());
+        REQUIRE(writeToString(actual.get()) == writeToString(expected.get()));
+    }
+}
+
+TEST_CASE("TestStructuralIndexPositions")
+{
+    std::string text = R"({ "a\"b" : [ 12, true ] })";
+    json::detail::StructuralIndex index(text);
+    std::vector<std::uint32_t> expected = { 0, 2, 7, 9, 11, 13, 15, 17, 22, 24 };
+    REQUIRE(index.getPositions() == expected);
+}
+
+TEST_CASE("TestStructuralIndexStringsAcrossBlocks")
+{
+    // escapes and quotes straddling the 64 byte block boundaries
+    std::string text = "{ \"key\" : \"" + std::string(57, 'x') + "\\\\\\\"" + std::string(70, 'y') + "\", \"other\" : \"" + std::string(62, 'z') + "\" }";
+    auto obj = json::parse(text, indexedOptions());
+    REQUIRE(obj->getStringValue("key") == std::string(57, 'x') + "\\\"" + std::string(70, 'y'));
+    REQUIRE(obj->getStringValue("other") == std::string(62, 'z'));
+}
+
+TEST_CASE("TestStructuralIndexReportsErrors")
+{
+    REQUIRE_THROWS_AS(json::parse(R"({ "foo" : 12-345 })", indexedOptions()), json::parse_exception);
+    REQUIRE_THROWS_AS(json::parse(R"({ "foo" : 12 345 })", indexedOptions()), json::parse_exception);
+    REQUIRE_THROWS_AS(json::parse(R"({ "foo" : "bar)", indexedOptions()), json::parse_exception);
+
+    try {
+        json::parse("{\n  \"foo\" : \"bar\"\n  \"baz\" : 1 }", indexedOptions());
+        FAIL("expected a parse_exception");
+    } catch (const json::parse_exception& e) {
+        REQUIRE(std::string(e.what()) == "Expecting '}' at line 3:3 but got 'baz' instead!");
+    }
+}
+
+TEST_CASE("TestLexingLongStringWithEscapes")
+{
+    std::string body = std::string(40, 'a') + "\\\"" + std::string(33, 'b') + "\\n" + std::string(17, 'c') + "\\u00e9" + "\t";
+    std::string text = "\"" + body + "\"";
+    json::detail::Lexer lexer(text);
+    auto tok = lexer.getToken();
+    REQUIRE(tok.type == json::detail::TokenType::STRING);
+    REQUIRE(tok.value == std::string(40, 'a') + "\"" + std::string(33, 'b') + "\n" + std::string(17, 'c') + "\xC3\xA9" + "\t");
+    REQUIRE(lexer.getPosition(tok.offset).pos == 1);
+    REQUIRE(lexer.getToken().type == json::detail::TokenType::NONE);
+}
+
+TEST_CASE("TestParseIntegersAreExact")
+{
+    std::string text =
+    R"({
+        "small" : 36,
+        "big" : 9007199254740993,
+        "min" : -9223372036854775808,
+        "umax" : 18446744073709551615,
+        "tooBig" : 18446744073709551616,
+        "negativeZero" : -0,
+        "decimal" : 36.0
+    })";
+    auto obj = json::parse(text);
+
+    auto small = static_cast<json::Number*>(obj->getValue("small"));
+    REQUIRE(small->isInt64());
+    REQUIRE(small->getInt64Value() == 36);
+
+    REQUIRE(obj->getInt64Value("big") == 9007199254740993);
+    REQUIRE(obj->getInt64Value("min") == std::numeric_limits<std::int64_t>::min());
+
+    auto umax = static_cast<json::Number*>(obj->getValue("umax"));
+    REQUIRE(umax->isUint64());
+    REQUIRE(umax->getUint64Value() == std::numeric_limits<std::uint64_t>::max());
+    REQUIRE(umax->getInt64Value() == std::numeric_limits<std::int64_t>::max());
+
+    REQUIRE(static_cast<json::Number*>(obj->getValue("tooBig"))->isDouble());
+    REQUIRE(static_cast<json::Number*>(obj->getValue("negativeZero"))->isDouble());
+    REQUIRE(static_cast<json::Number*>(obj->getValue("decimal"))->isDouble());
+    REQUIRE(obj->getInt64Value("decimal") == 36);
+}
+
+TEST_CASE("TestWriteIntegers")
+{
+    auto obj = std::make_unique<json::Object>();
+    obj->addValue("a", std::make_unique<json::Number>(std::numeric_limits<std::int64_t>::min()));
+    obj->addValue("b", std::make_unique<json::Number>(std::numeric_limits<std::uint64_t>::max()));
+    obj->addValue("c", std::make_unique<json::Number>(0));
+    obj->addValue("d", std::make_unique<json::Number>(1234567));
+    REQUIRE(writeToString(obj.get()) == R"({ "a" : -9223372036854775808, "b" : 18446744073709551615, "c" : 0, "d" : 1234567 })");
+}
+
+struct RecordingHandler : public json::ParseHandler {
+    std::string events;
+
+    virtual void startObject() override { events += "{"; }
+    virtual void key(json::StringView name) override { events += name.str() + ":"; }
+    virtual void endObject() override { events += "}"; }
+    virtual void startArray() override { events += "["; }
+    virtual void endArray() override { events += "]"; }
+    virtual void string(json::StringView value) override { events += "'" + value.str() + "' "; }
+    virtual void number(const json::Number& value) override { events += std::to_string(value.getInt64Value()) + " "; }
+    virtual void boolean(bool value) override { events += value ? "true " : "false "; }
+    virtual void null() override { events += "null "; }
+};
+
+TEST_CASE("TestParseEvents")
+{
+    std::string text =
+    R"({
+        "foo" : "bar",
+        "arr" : [ 1, { "x" : null }, [], true ],
+        "obj" : {}
+    })";
+
+    RecordingHandler handler;
+    json::parse(text, &handler);
+    REQUIRE(handler.events == "{foo:'bar' arr:[1 {x:null }[]true ]obj:{}}");
+
+    RecordingHandler indexed;
+    json::parse(text, &indexed, indexedOptions());
+    REQUIRE(indexed.events == handler.events);
+}
+
+TEST_CASE("TestParseEventsOnlyOverridesWhatItNeeds")
+{
+    struct AgeSum : public json::ParseHandler {
+        bool inAge = false;
+        double sum = 0;
+        virtual void key(json::StringView name) override { inAge = name == "age"; }
+        virtual void number(const json::Number& value) override { if (inAge) sum += value.getValue(); }
+    } handler;
+
+    json::parse(DB_JSON, &handler);
+    REQUIRE(handler.sum == 36 + 24 + 30 + 38 + 29);
+}
+
+TEST_CASE("TestParseEventsMalformedThrows")
+{
+    RecordingHandler handler;
+    REQUIRE_THROWS_AS(json::parse(R"({ "foo" : [ 1, 2 })", &handler), json::parse_exception);
+    REQUIRE_THROWS_AS(json::parse(R"([ 1 ])", &handler), json::parse_exception);
+}
+
+TEST_CASE("TestPushParserAnyChunkSize")
+{
+    std::string text = YOUTUBE_SEARCH_JSON;
+    text.insert(text.find("\"pageInfo\""), R"("numbers" : [ -12, 3.25e-2, 18446744073709551615, true, false, null, "\u00e9\n\"" ], )");
+
+    RecordingHandler expected;
+    json::parse(text, &expected);
+
+    for (size_t chunk = 1; chunk <= 65; chunk += 4) {
+        RecordingHandler handler;
+        json::PushParser parser(&handler);
+        for (size_t offset = 0; offset < text.size(); offset += chunk) {
+            parser.feed(text.data() + offset, std::min(chunk, text.size() - offset));
+        }
+        parser.finish();
+        REQUIRE(parser.isComplete());
+        REQUIRE(handler.events == expected.events);
+    }
+}
+
+TEST_CASE("TestPushParserBuildsDocument")
+{
+    json::DocumentBuilder builder;
+    json::PushParser parser(&builder);
+
+    std::string text = DB_JSON;
+    size_t half = text.size() / 2;
+    parser.feed(text.data(), half);
+    REQUIRE(builder.release() == nullptr);
+    parser.feed(text.data() + half, text.size() - half);
+    parser.finish();
+
+    auto obj = builder.release();
+    REQUIRE(obj != nullptr);
+    REQUIRE(writeToString(obj.get()) == writeToString(json::parse(text).get()));
+}
+
+TEST_CASE("TestPushParserStopsAtTheEndOfTheDocument")
+{
+    RecordingHandler handler;
+    json::PushParser parser(&handler);
+    std::string text = R"({ "a" : 12 }{ "b" : 34 })";
+    REQUIRE(parser.feed(text.data(), text.size()) == 12);
+    REQUIRE(parser.isComplete());
+    REQUIRE(handler.events == "{a:12 }");
+}
+
+TEST_CASE("TestPushParserMalformedThrows")
+{
+    auto pushAll = [](const std::string& text) {
+        json::ParseHandler handler;
+        json::PushParser parser(&handler);
+        for (char c : text) {
+            parser.feed(&c, 1);
+        }
+        parser.finish();
+    };
+
+    REQUIRE_NOTHROW(pushAll(R"({ "foo" : [ 1, 2 ] })"));
+    REQUIRE_THROWS_AS(pushAll(R"({ "foo" : [ 1, 2 })"), json::parse_exception);
+    REQUIRE_THROWS_AS(pushAll(R"({ "foo" : 12-345 })"), json::parse_exception);
+    REQUIRE_THROWS_AS(pushAll(R"({ "foo" : "\uABCDE" })"), json::parse_exception);
+    REQUIRE_THROWS_AS(pushAll(R"({ "foo" : "\x" })"), json::parse_exception);
+    REQUIRE_THROWS_AS(pushAll(R"({ "foo" : tru })"), json::parse_exception);
+    REQUIRE_THROWS_AS(pushAll(R"({ "foo" : "bar)"), json::parse_exception);
+    REQUIRE_THROWS_AS(pushAll(R"({ "foo" : 1.)"), json::parse_exception);
+
+    try {
+        pushAll("{\n  \"foo\" : \"bar\"\n  \"baz\" : 1 }");
+        FAIL("expected a parse_exception");
+    } catch (const json::parse_exception& e) {
+        REQUIRE(std::string(e.what()) == "Expecting '}' at line 3:3 but got 'baz' instead!");
+    }
+}
+
+static std::string makeLines(size_t count)
+{
+    std::string text;
+    for (size_t i = 1; i <= count; ++i) {
+        if (i % 10 == 0) {
+            text += "{ \"id\" : " + std::to_string(i) + ", \"broken\" \n"; // every tenth line is malformed
+        } else if (i % 7 == 0) {
+            text += "   \n"; // blank lines are skipped
+        } else {
+            text += "{ \"id\" : " + std::to_string(i) + " }\n";
+        }
+    }
+    return text;
+}
+
+TEST_CASE("TestParseLinesInOrder")
+{
+    auto text = makeLines(1000);
+    json::LineOptions options;
+    options.threads = 4;
+    options.batchSize = 100;
+
+    std::vector<size_t> lines;
+    json::parseLines(text, [&](json::LineResult& result) {
+        lines.push_back(result.line);
+        if (result.line % 10 == 0) {
+            REQUIRE(result.object == nullptr);
+            REQUIRE(!result.error.empty());
+        } else {
+            REQUIRE(result.object != nullptr);
+            REQUIRE(result.object->getInt64Value("id") == static_cast<std::int64_t>(result.line));
+        }
+    }, options);
+
+    std::vector<size_t> expected;
+    for (size_t i = 1; i <= 1000; ++i) {
+        if (i % 10 == 0 || i % 7 != 0) {
+            expected.push_back(i);
+        }
+    }
+    REQUIRE(lines == expected);
+}
+
+TEST_CASE("TestParseLinesUnordered")
+{
+    auto text = makeLines(1000);
+    json::LineOptions options;
+    options.threads = 3;
+    options.ordered = false;
+    options.batchSize = 64;
+
+    std::vector<size_t> lines;
+    size_t failures = 0;
+    json::parseLines(text, [&](json::LineResult& result) {
+        lines.push_back(result.line);
+        failures += result.object == nullptr ? 1 : 0;
+    }, options);
+
+    std::sort(lines.begin(), lines.end());
+    REQUIRE(std::adjacent_find(lines.begin(), lines.end()) == lines.end());
+    REQUIRE(lines.size() == 1000 - (142 - 14));
+    REQUIRE(failures == 100);
+}
+
+TEST_CASE("TestParseLinesCallbackExceptionStopsWorkers")
+{
+    auto text = makeLines(1000);
+    json::LineOptions options;
+    options.threads = 4;
+    options.batchSize = 100;
+
+    size_t calls = 0;
+    REQUIRE_THROWS_AS(json::parseLines(text, [&](json::LineResult&) {
+        if (++calls == 5) {
+            throw std::runtime_error("stop");
+        }
+    }, options), std::runtime_error);
+    REQUIRE(calls == 5);
+}
+
+static json::ParseOptions arenaOptions()
+{
+    json::ParseOptions options;
+    options.arena = true;
+    return options;
+}
+
+TEST_CASE("TestArenaMatchesRegularParsing")
+{
+    for (auto text : { DB_JSON, GOOGLE_MARKERS_JSON, YOUTUBE_SEARCH_JSON }) {
+        auto expected = json::parse(text);
+        auto actual = json::parse(text, arenaOptions());
+        REQUIRE(writeToString(actual.get()) == writeToString(expected.get()));
+
+        auto options = arenaOptions();
+        options.structuralIndex = true;
+        actual = json::parse(text, options);
+        REQUIRE(writeToString(actual.get()) == writeToString(expected.get()));
+    }
+}
+
+TEST_CASE("TestArenaDocumentKeepsExistingBehaviour")
+{
+    auto obj = json::parse(R"({ "b" : "x", "a" : { "c" : [ 1, "two", null ] }, "b" : "y", "" : true })", arenaOptions());
+    REQUIRE(obj->size() == 3);
+    REQUIRE(obj->getStringValue("b") == "x");
+    REQUIRE(obj->getBoolValue(""));
+    REQUIRE(obj->getArrayValue("c")->getStringValue(1) == "two");
+
+    // values added after parsing come from the heap and are freed with the rest of the document
+    obj->getObjectValue("a")->addValue("d", std::make_unique<json::String>("added"));
+    obj->addValue("aa", std::make_unique<json::Number>(1.5));
+    REQUIRE(writeToString(obj.get()) == R"({ "b" : "x", "a" : { "c" : [ 1, "two", null ], "d" : "added" }, "" : true, "aa" : 1.5 })");
+}
+
+// Counts every allocation of the test program, so a test can tell how many a call made. The replacements below
+// are a matching pair, which GCC cannot tell once they are inlined.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+static std::atomic<size_t> heapAllocations(0);
+static std::atomic<size_t> lastAllocationSize(0);
+
+// Makes every allocation throw, with a std::bad_alloc or with something that is not a std::exception, or only the
+// allocations of threads other than the one running the tests
+enum class RefuseAllocations { NO, BAD_ALLOC, OTHER, WORKER_BAD_ALLOC };
+static RefuseAllocations refuseAllocations = RefuseAllocations::NO;
+static const std::thread::id testThread = std::this_thread::get_id();
+struct AllocationRefused {};
+
+void* operator new(size_t size)
+{
+    ++heapAllocations;
+    lastAllocationSize = size;
+    if (refuseAllocations == RefuseAllocations::BAD_ALLOC
+        || (refuseAllocations == RefuseAllocations::WORKER_BAD_ALLOC && std::this_thread::get_id() != testThread)) {
+        throw std::bad_alloc();
+    } else if (refuseAllocations == RefuseAllocations::OTHER) {
+        throw AllocationRefused();
+    }
+    if (void* p = std::malloc(size != 0 ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+TEST_CASE("TestArenaParsingStaysOffTheHeap")
+{
+    std::string text = "{ \"items\" : [";
+    for (int i = 0; i < 1000; ++i) {
+        text += (i != 0 ? ", " : " ") + std::string(R"({ "id" : 1, "name" : "a name that is too long for small strings", "tags" : [ "x", "y" ] })");
+    }
+    text += " ] }";
+
+    for (bool structuralIndex : { false, true }) {
+        auto options = arenaOptions();
+        options.structuralIndex = structuralIndex;
+        const size_t before = heapAllocations;
+        auto obj = json::parse(text, options);
+        const size_t allocations = heapAllocations - before;
+        REQUIRE(obj->getArrayValue("items")->size() == 1000);
+
+        // a handful for the arena chunks and the document, nothing per value
+        REQUIRE(allocations < 100);
+    }
+}
+
+TEST_CASE("TestHeapValuesAllocateOnlyThemselves")
+{
+    auto number = std::make_unique<json::Number>(1.5);
+    REQUIRE(lastAllocationSize == sizeof(json::Number));
+    auto obj = std::make_unique<json::Object>();
+    REQUIRE(lastAllocationSize == sizeof(json::Object));
+    obj->addValue("n", std::move(number));
+    REQUIRE(obj->getNumberValue("n") == 1.5);
+}
+
+TEST_CASE("TestArenaReportsErrors")
+{
+    REQUIRE_THROWS_AS(json::parse(R"({ "foo" : [ "bar", { "baz" : 1 ] })", arenaOptions()), json::parse_exception);
+    REQUIRE_THROWS_AS(json::parse(R"({ "foo" : "bar)", arenaOptions()), json::parse_exception);
+}
+
+static bool sameValue(const json::Value* expected, json::ValueView actual)
+{
+    if (expected->isObject()) {
+        auto obj = static_cast<const json::Object*>(expected);
+        auto view = actual.asObject();
+        if (!view || view.size() != obj->size()) {
+            return false;
+        }
+        for (auto& p : obj->getValues()) {
+            if (!sameValue(p.second, view.getValue(p.first))) {
+                return false;
+            }
+        }
+        return true;
+    } else if (expected->isArray()) {
+        auto arr = static_cast<const json::Array*>(expected);
+        auto view = actual.asArray();
+        if (!view || view.size() != arr->size()) {
+            return false;
+        }
+        size_t i = 0;
+        for (auto value : view) {
+            if (!sameValue(arr->getValue(i++), value)) {
+                return false;
+            }
+        }
+        return i == arr->size();
+    } else if (expected->isString()) {
+        return actual.isString() && actual.asString() == static_cast<const json::String*>(expected)->getValue();
+    } else if (expected->isNumber()) {
+        auto number = static_cast<const json::Number*>(expected);
+        return actual.isNumber() && actual.asNumber() == number->getValue() && actual.asInt64() == number->getInt64Value()
+            && actual.asUint64() == number->getUint64Value();
+    } else if (expected->isBool()) {
+        return actual.isBool() && actual.asBool() == static_cast<const json::Bool*>(expected)->getValue();
+    }
+    return actual.isNull();
+}
+
+TEST_CASE("TestDocumentMatchesRegularParsing")
+{
+    for (auto text : { DB_JSON, GOOGLE_MARKERS_JSON, YOUTUBE_SEARCH_JSON }) {
+        auto expected = json::parse(text);
+        auto document = json::parseDocument(text);
+        REQUIRE(sameValue(expected.get(), document.getRoot()));
+
+        document = json::parseDocument(text, indexedOptions());
+        REQUIRE(sameValue(expected.get(), document.getRoot()));
+    }
+}
+
+TEST_CASE("TestEmptyDocumentHasAnEmptyRoot")
+{
+    json::Document empty;
+    REQUIRE(!empty.getRoot());
+    REQUIRE(empty.getRoot().size() == 0);
+    REQUIRE(!empty.getRoot().getValue("a"));
+
+    auto document = json::parseDocument(R"({ "a" : 1 })");
+    json::Document moved(std::move(document));
+    REQUIRE(moved.getRoot().getInt64Value("a") == 1);
+    REQUIRE(!document.getRoot());
+    REQUIRE(document.getRoot().begin() == document.getRoot().end());
+}
+
+TEST_CASE("TestDocumentAccessors")
+{
+    auto document = json::parseDocument(R"({ "name" : "x", "list" : [ 1, -2, 18446744073709551615, 2.5, "s", true, null, { "inner" : [] } ],
+        "name" : "duplicate", "nested" : { "deep" : false } })");
+    auto root = document.getRoot();
+    REQUIRE(root.size() == 3);
+    REQUIRE(root.getStringValue("name") == "x");
+    REQUIRE(root.getStringValue("list", "default") == "default");
+    REQUIRE(root.getBoolValue("deep", true) == false); // found in the first nested object
+    REQUIRE(!root.getValue("missing"));
+
+    auto list = root.getArrayValue("list");
+    REQUIRE(list.size() == 8);
+    REQUIRE(list.getInt64Value(1) == -2);
+    REQUIRE(list.getUint64Value(2) == 18446744073709551615ULL);
+    REQUIRE(list.getNumberValue(3) == 2.5);
+    REQUIRE(list.getStringValue(4) == "s");
+    REQUIRE(list.getBoolValue(5));
+    REQUIRE(list.getValue(6).isNull());
+    REQUIRE(list.getObjectValue(7).getArrayValue("inner").size() == 0);
+    REQUIRE(!list.getValue(8));
+
+    std::string names;
+    for (auto member : root) {
+        names += member.name.str() + ",";
+    }
+    REQUIRE(names == "name,list,nested,");
+
+    // empty views are safe to use
+    json::ObjectView empty = root.getObjectValue("name");
+    REQUIRE(!empty);
+    REQUIRE(empty.size() == 0);
+    REQUIRE(empty.begin() == empty.end());
+    REQUIRE(empty.getStringValue("name", "default") == "default");
+}
+
+TEST_CASE("TestDocumentDropsDuplicateMembersLikeTheDom")
+{
+    // values of later duplicates are left out whatever they are, and names only clash within one object
+    std::string text = R"({ "a" : 1, "b" : { "a" : 2, "a" : [ 3, { "a" : 4 } ] }, "a" : { "x" : [ 5 ] }, "c" : [ { "a" : 6 }, { "a" : 7 } ], "b" : null, )";
+
+    // past the size where names are looked up in an index rather than scanned
+    for (int i = 0; i < 200; ++i) {
+        text += "\"k" + std::to_string(i % 80) + "\" : " + std::to_string(i) + ", ";
+    }
+    text += R"("z" : true })";
+
+    for (auto options : { json::ParseOptions(), indexedOptions() }) {
+        auto obj = json::parse(text, options);
+        auto document = json::parseDocument(text, options);
+        auto root = document.getRoot();
+        REQUIRE(sameValue(obj.get(), root));
+        REQUIRE(root.size() == obj->size());
+        REQUIRE(root.size() == 84);
+        REQUIRE(root.getInt64Value("a") == 1);
+        REQUIRE(root.getObjectValue("b").size() == 1);
+        REQUIRE(root.getInt64Value("k79") == 79);
+        REQUIRE(root.getArrayValue("c").getObjectValue(1).getInt64Value("a") == 7);
+        REQUIRE(root.getBoolValue("z"));
+
+        std::string names;
+        for (auto member : root) {
+            names += member.name.str() + ",";
+        }
+        REQUIRE(names.substr(0, 12) == "a,b,c,k0,k1,");
+    }
+}
+
+TEST_CASE("TestDocumentFromPushParser")
+{
+    std::string text = R"({ "a" : [ 1, { "b" : "c" } ], "d" : null })";
+    json::TapeBuilder builder;
+    json::PushParser parser(&builder);
+    for (auto c : text) {
+        parser.feed(&c, 1);
+    }
+    parser.finish();
+    auto document = builder.release();
+    REQUIRE(document.getRoot().getArrayValue("a").getObjectValue(1).getStringValue("b") == "c");
+    REQUIRE_THROWS_AS(builder.release(), json::parse_exception);
+}
+
+TEST_CASE("TestDocumentIsSmallerThanTheDOM")
+{
+    std::string text = "{ \"records\" : [";
+    for (int i = 0; i < 1000; ++i) {
+        text += (i ? ", " : "") + std::string(R"({ "id" : )") + std::to_string(i) + R"(, "name" : "record", "active" : true })";
+    }
+    text += "] }";
+
+    auto document = json::parseDocument(text);
+    size_t active = 0;
+    for (auto record : document.getRoot().getArrayValue("records")) {
+        active += record.asObject().getBoolValue("active") ? 1 : 0;
+    }
+    REQUIRE(active == 1000);
+    REQUIRE(document.getMemoryUsage() < text.size() * 3);
+}
+
+TEST_CASE("TestWideObjectLookups")
+{
+    std::string text = "{";
+    for (int i = 0; i < 300; ++i) {
+        text += (i ? ", \"key" : "\"key") + std::to_string(i) + "\" : " + std::to_string(i);
+    }
+    text += ", \"key7\" : \"duplicate\", \"key299\" : \"duplicate\" }";
+
+    for (auto options : { json::ParseOptions(), arenaOptions() }) {
+        auto obj = json::parse(text, options);
+        REQUIRE(obj->size() == 300);
+        for (int i = 0; i < 300; ++i) {
+            REQUIRE(obj->getInt64Value("key" + std::to_string(i), -1) == i);
+        }
+        REQUIRE(obj->getValue("key300") == nullptr);
+        REQUIRE(obj->getValue("") == nullptr);
+
+        obj->addValue("added", std::make_unique<json::String>("value"));
+        obj->addValue("key0", std::make_unique<json::String>("ignored"));
+        REQUIRE(obj->size() == 301);
+        REQUIRE(obj->getStringValue("added") == "value");
+        REQUIRE(obj->getInt64Value("key0", -1) == 0);
+    }
+}
+
+TEST_CASE("TestRecursiveSearchUsesTheFirstNestedObject")
+{
+    auto obj = json::parse(R"({ "z" : { "inner" : 1 }, "a" : { "inner" : 2 } })");
+    REQUIRE(obj->getInt64Value("inner") == 1);
+}
+
+TEST_CASE("TestKeyTableInternsOnce")
+{
+    json::KeyTable keys;
+    auto a = keys.intern("name");
+    REQUIRE(a.name() == "name");
+    REQUIRE(keys.intern(std::string("name")) == a);
+    REQUIRE(keys.intern("other") != a);
+    REQUIRE(keys.find("name") == a);
+    REQUIRE(!keys.find("missing"));
+    REQUIRE(keys.size() == 2);
+
+    for (int i = 0; i < 1000; ++i) {
+        keys.intern("key" + std::to_string(i));
+    }
+    REQUIRE(keys.size() == 1002);
+    REQUIRE(keys.find("name") == a);
+    REQUIRE(keys.find("key999").name() == "key999");
+}
+
+TEST_CASE("TestParseWithSharedKeys")
+{
+    json::ParseOptions options;
+    options.keys = std::make_shared<json::KeyTable>();
+
+    std::string wide = "{";
+    for (int i = 0; i < 40; ++i) {
+        wide += (i ? ", \"key" : "\"key") + std::to_string(i) + "\" : " + std::to_string(i);
+    }
+    wide += " }";
+
+    for (auto arena : { false, true }) {
+        options.arena = arena;
+        auto first = json::parse(R"({ "id" : 1, "name" : "a", "inner" : { "id" : 2, "deep" : true } })", options);
+        auto second = json::parse(R"({ "name" : "b", "id" : 3 })", options);
+        auto third = json::parse(wide, options);
+        REQUIRE(options.keys->size() == 4 + 40 + (arena ? 1 : 0)); // the second round also has the key added below
+
+        auto id = options.keys->intern("id");
+        REQUIRE(first->getValue(id) == first->getValue("id"));
+        REQUIRE(second->getInt64Value("id") == 3);
+        REQUIRE(static_cast<json::Number*>(second->getValue(id))->getInt64Value() == 3);
+        REQUIRE(first->getValue(options.keys->intern("deep")) != nullptr);
+        REQUIRE(third->getInt64Value("key39") == 39);
+        REQUIRE(static_cast<json::Number*>(third->getValue(options.keys->intern("key20")))->getInt64Value() == 20);
+        REQUIRE(third->getValue(id) == nullptr);
+
+        // keys of other tables are compared by name
+        json::KeyTable other;
+        REQUIRE(second->getValue(other.intern("name")) == second->getValue("name"));
+
+        second->addValue("added", std::make_unique<json::Bool>(true));
+        REQUIRE(second->getValue(options.keys->find("added")) != nullptr);
+    }
+}
+
+TEST_CASE("TestParseLinesWithSharedKeys")
+{
+    auto text = makeLines(1000);
+    json::LineOptions options;
+    options.threads = 4;
+    options.batchSize = 100;
+    options.parseOptions.keys = std::make_shared<json::KeyTable>();
+    auto id = options.parseOptions.keys->intern("id");
+
+    size_t parsed = 0;
+    json::parseLines(text, [&](json::LineResult& result) {
+        if (result.object != nullptr) {
+            REQUIRE(static_cast<json::Number*>(result.object->getValue(id))->getUint64Value() == result.line);
+            ++parsed;
+        }
+    }, options);
+    REQUIRE(parsed == 1000 - 142 + 14 - 100);
+    REQUIRE(options.parseOptions.keys->size() == 1);
+}
+
+TEST_CASE("TestParseWithSharedShapes")
+{
+    std::string text = R"({ "samples" : [)";
+    for (int i = 0; i < 100; ++i) {
+        text += (i ? ", " : "") + std::string(R"({ "id" : )") + std::to_string(i) + R"(, "name" : "n", "id" : "duplicate", "ok" : true })";
+    }
+    text += R"(, { "ok" : false, "id" : -1 } ] })";
+
+    json::ParseOptions options;
+    options.shapes = std::make_shared<json::ShapeTable>();
+    for (auto arena : { false, true }) {
+        options.arena = arena;
+        auto obj = json::parse(text, options);
+        REQUIRE(writeToString(obj.get()) == writeToString(json::parse(text).get()));
+
+        // samples, id, name and ok in one chain, ok and id in another, and extra from the first round
+        REQUIRE(options.shapes->size() == 1 + 3 + 2 + (arena ? 1 : 0));
+
+        auto samples = obj->getArrayValue("samples");
+        auto id = options.shapes->getKeys()->intern("id");
+        for (size_t i = 0; i < 100; ++i) {
+            auto record = samples->getObjectValue(i);
+            REQUIRE(record->size() == 3);
+            REQUIRE(static_cast<json::Number*>(record->getValue(id))->getInt64Value() == static_cast<std::int64_t>(i));
+            REQUIRE(record->getStringValue("name") == "n");
+        }
+
+        // adding to a shared layout moves the object to another one and leaves the others alone
+        auto first = samples->getObjectValue(0);
+        first->addValue("extra", std::make_unique<json::Null>());
+        first->addValue("name", std::make_unique<json::Null>());
+        REQUIRE(first->size() == 4);
+        REQUIRE(first->getNullValue("extra") == nullptr);
+        REQUIRE(first->getValue("extra") != nullptr);
+        REQUIRE(samples->getObjectValue(1)->getValue("extra") == nullptr);
+    }
+}
+
+TEST_CASE("TestSharedShapesFallBackToOwnLayouts")
+{
+    json::ParseOptions options;
+    options.shapes = std::make_shared<json::ShapeTable>();
+
+    std::string wide = "{";
+    for (size_t i = 0; i < json::ShapeTable::MAX_MEMBERS + 10; ++i) {
+        wide += (i ? ", \"key" : "\"key") + std::to_string(i) + "\" : " + std::to_string(i);
+    }
+    wide += " }";
+    auto obj = json::parse(wide, options);
+    REQUIRE(obj->size() == json::ShapeTable::MAX_MEMBERS + 10);
+    REQUIRE(options.shapes->size() == json::ShapeTable::MAX_MEMBERS);
+    for (size_t i = 0; i < obj->size(); ++i) {
+        REQUIRE(obj->getUint64Value("key" + std::to_string(i), 1000) == i);
+    }
+
+    std::string maps = R"({ "values" : [)";
+    for (size_t i = 0; i < json::ShapeTable::MAX_SHAPES + 10; ++i) {
+        maps += (i ? ", { \"k" : "{ \"k") + std::to_string(i) + "\" : " + std::to_string(i) + " }";
+    }
+    maps += "] }";
+    obj = json::parse(maps, options);
+    REQUIRE(options.shapes->size() == json::ShapeTable::MAX_SHAPES);
+    auto last = json::ShapeTable::MAX_SHAPES + 9;
+    REQUIRE(obj->getArrayValue("values")->getObjectValue(last)->getUint64Value("k" + std::to_string(last)) == last);
+}
+
+TEST_CASE("TestIteratingWithoutCopies")
+{
+    auto obj = json::parse(R"({ "b" : "first", "a" : [ "x", 2, "y" ], "c" : { "d" : "e" } })");
+
+    std::string names;
+    for (auto member : *obj) {
+        names += member.name.str();
+        REQUIRE(member.value == obj->getValue(member.name));
+    }
+    REQUIRE(names == "bac");
+
+    auto view = obj->getStringView("b");
+    REQUIRE(view == "first");
+    REQUIRE(view.data() == obj->getStringView("b").data());
+    REQUIRE(obj->getStringView("a", "default") == "default");
+    REQUIRE(obj->getStringView("d") == "e");
+
+    auto arr = obj->getArrayValue("a");
+    std::string strings;
+    size_t count = 0;
+    for (auto value : *arr) {
+        ++count;
+        if (value->isString()) {
+            strings += static_cast<json::String*>(value)->getStringView().str();
+        }
+    }
+    REQUIRE(count == 3);
+    REQUIRE(strings == "xy");
+    REQUIRE(arr->getStringView(1, "none") == "none");
+    REQUIRE(arr->getStringView(2) == "y");
+
+    json::Object empty;
+    REQUIRE(empty.begin() == empty.end());
+}
+
+TEST_CASE("TestFindValueIsBreadthFirst")
+{
+    std::string text = R"({
+        "a" : { "b" : { "name" : "deep" } },
+        "list" : [ { "name" : "in array" }, { "other" : { "name" : "deeper" } } ],
+        "c" : { "name" : "shallow" }
+    })";
+
+    json::ParseOptions indexed;
+    indexed.keyIndex = true;
+    for (auto options : { json::ParseOptions(), indexed }) {
+        auto obj = json::parse(text, options);
+        REQUIRE(obj->getStringValue("name") == "deep");
+        REQUIRE(static_cast<json::String*>(obj->findValue("name"))->getValue() == "shallow");
+        REQUIRE(obj->findValue("missing") == nullptr);
+
+        std::string order;
+        for (auto value : obj->findValues("name")) {
+            order += static_cast<json::String*>(value)->getValue() + ",";
+        }
+        REQUIRE(order == "shallow,deep,in array,deeper,");
+
+        // changes anywhere in the document are seen by the next lookup
+        obj->getObjectValue("a")->addValue("name", std::make_unique<json::String>("added"));
+        REQUIRE(static_cast<json::String*>(obj->findValue("name"))->getValue() == "added");
+        auto object = std::make_unique<json::Object>();
+        object->addValue("extra", std::make_unique<json::Null>());
+        obj->getArrayValue("list")->addValue(std::move(object));
+        REQUIRE(obj->findValue("extra") != nullptr);
+        REQUIRE(obj->findValues("name").size() == 5);
+
+        // lookups below the root search that subtree only
+        REQUIRE(static_cast<json::String*>(obj->getObjectValue("b")->findValue("name"))->getValue() == "deep");
+    }
+}
+
+TEST_CASE("TestKeyIndexSeesChangesToAttachedValues")
+{
+    json::ParseOptions options;
+    options.keyIndex = true;
+    for (bool arena : { false, true }) {
+        options.arena = arena;
+        auto obj = json::parse(R"({ "a" : { "b" : 1 } })", options);
+        REQUIRE(obj->findValue("added") == nullptr);
+
+        // containers built on the heap, attached to the document, then changed
+        auto list = std::make_unique<json::Array>();
+        list->addValue(std::make_unique<json::Object>());
+        obj->getObjectValue("a")->addValue("child", std::make_unique<json::Object>());
+        obj->addValue("list", std::move(list));
+        REQUIRE(obj->findValue("added") == nullptr);
+
+        obj->getObjectValue("a")->getObjectValue("child")->addValue("added", std::make_unique<json::String>("child"));
+        REQUIRE(obj->findValue("added") != nullptr);
+        static_cast<json::Object*>(obj->getArrayValue("list")->getValue(0))->addValue("added", std::make_unique<json::Bool>(true));
+        obj->getArrayValue("list")->addValue(std::make_unique<json::Null>());
+        REQUIRE(obj->findValues("added").size() == 2);
+        REQUIRE(obj->getArrayValue("list")->size() == 2);
+    }
+}
+
+TEST_CASE("TestPathQueries")
+{
+    std::string text = R"({
+        "store" : {
+            "book" : [
+                { "category" : "reference", "author" : "Nigel Rees", "title" : "Sayings of the Century", "price" : 8.95 },
+                { "category" : "fiction", "author" : "Evelyn Waugh", "title" : "Sword of Honour", "price" : 12.99 },
+                { "category" : "fiction", "author" : "Herman Melville", "title" : "Moby Dick", "isbn" : "0-553-21311-3", "price" : 8.99 },
+                { "category" : "fiction", "author" : "J. R. R. Tolkien", "title" : "The Lord of the Rings", "isbn" : "0-395-19395-8", "price" : 22.99 }
+            ],
+            "bicycle" : { "color" : "red", "price" : 19.95, "sold" : false }
+        },
+        "expensive" : 10
+    })";
+    auto obj = json::parse(text);
+    auto document = json::parseDocument(text);
+
+    // the DOM, the tape and the event stream find the same values
+    auto check = [&](const std::string& expression, size_t expected) {
+        json::Path path(expression);
+        auto values = path.select(obj.get());
+        auto views = path.select(document.getRoot());
+        REQUIRE(values.size() == expected);
+        REQUIRE(views.size() == expected);
+        for (size_t i = 0; i < expected; ++i) {
+            REQUIRE(sameValue(values[i], views[i]));
+        }
+
+        // streamed values are reported when they end, so containers come after what they contain
+        std::vector<bool> seen(expected, false);
+        size_t streamed = 0;
+        path.stream(text, [&](const json::Value& value) {
+            size_t i = 0;
+            while (i < expected && (seen[i] || !sameValue(&value, views[i]))) {
+                ++i;
+            }
+            REQUIRE(i < expected);
+            seen[i] = true;
+            ++streamed;
+        });
+        REQUIRE(streamed == expected);
+        return values;
+    };
+
+    REQUIRE(check("$", 1)[0] == obj.get());
+    REQUIRE(static_cast<json::String*>(check("$.store.book[0].title", 1)[0])->getValue() == "Sayings of the Century");
+    REQUIRE(static_cast<json::String*>(check("$['store'][\"book\"][3]['author']", 1)[0])->getValue() == "J. R. R. Tolkien");
+    check("$.store.book[4]", 0);
+    check("$.store.missing.title", 0);
+    check("$.store.book[*].author", 4);
+    check("$.store.*", 2);
+    check("$.store..price", 5);
+    check("$..book[2]", 1);
+    check("$..*", 29);
+    check("$.store.book[?(@.isbn)].title", 2);
+    check("$.store.book[?(@.price < 10)]", 2);
+    check("$.store.book[?(@.price >= 12.99)].price", 2);
+    check("$.store.book[?(@.category == 'fiction')]", 3);
+    check("$.store.book[?(@.category != \"fiction\")].author", 1);
+    check("$..[?(@.sold == false)].color", 1);
+    check("$.store.book[*].price[?(@ > 10)]", 0);
+
+    std::string order;
+    for (auto value : json::Path("$..author").select(obj.get())) {
+        order += static_cast<json::String*>(value)->getValue().substr(0, 2);
+    }
+    REQUIRE(order == "NiEvHeJ.");
+
+    // matches are reported through a push parser as soon as they end
+    std::vector<std::string> titles;
+    json::PathHandler handler(json::Path("$.store.book[*].title"), [&](const json::Value& value) {
+        titles.push_back(static_cast<const json::String&>(value).getValue());
+    });
+    json::PushParser parser(&handler);
+    for (size_t i = 0; i < text.size(); i += 7) {
+        parser.feed(text.data() + i, std::min<size_t>(7, text.size() - i));
+    }
+    parser.finish();
+    REQUIRE(titles.size() == 4);
+    REQUIRE(titles[2] == "Moby Dick");
+}
+
+TEST_CASE("TestStreamedPathsBuildEachValueOnce")
+{
+    // every value of a deep document matches, inside as many other matches as it is deep
+    const int depth = 500;
+    std::string text = "{ \"a\" : ";
+    for (int i = 0; i < depth; ++i) {
+        text += "[ 1, ";
+    }
+    text += "true";
+    for (int i = 0; i < depth; ++i) {
+        text += " ]";
+    }
+    text += " }";
+
+    size_t matches = 0;
+    size_t innermost = 0; // the size of the first array, which ends first
+    const size_t before = heapAllocations;
+    json::Path("$..*").stream(text, [&](const json::Value& value) {
+        ++matches;
+        if (value.isArray() && innermost == 0) {
+            innermost = static_cast<const json::Array&>(value).size();
+        }
+    });
+    const size_t allocations = heapAllocations - before;
+    REQUIRE(matches == 2 * depth + 1);
+    REQUIRE(innermost == 2);
+    REQUIRE(allocations < 20 * depth);
+}
+
+TEST_CASE("TestPathFiltersCompareIntegersExactly")
+{
+    std::string text = R"({ "items" : [
+        { "id" : 9007199254740992, "name" : "a" },
+        { "id" : 9007199254740993, "name" : "b" },
+        { "id" : 18446744073709551615, "name" : "c" },
+        { "id" : -9223372036854775808, "name" : "d" },
+        { "id" : 9007199254740993.0, "name" : "e" }
+    ] })";
+    auto obj = json::parse(text);
+    auto document = json::parseDocument(text);
+
+    auto names = [&](const std::string& expression) {
+        json::Path path(expression + ".name");
+        std::string fromValues;
+        for (auto value : path.select(obj.get())) {
+            fromValues += static_cast<json::String*>(value)->getValue();
+        }
+        std::string fromViews;
+        for (auto view : path.select(document.getRoot())) {
+            fromViews += view.asString().str();
+        }
+        std::string streamed;
+        path.stream(text, [&](const json::Value& value) {
+            streamed += static_cast<const json::String&>(value).getValue();
+        });
+        REQUIRE(fromViews == fromValues);
+        REQUIRE(streamed == fromValues);
+        return fromValues;
+    };
+
+    REQUIRE(names("$.items[?(@.id == 9007199254740993)]") == "b");
+    REQUIRE(names("$.items[?(@.id < 9007199254740993)]") == "ade");
+    REQUIRE(names("$.items[?(@.id > 9007199254740992)]") == "bc");
+    REQUIRE(names("$.items[?(@.id == 18446744073709551615)]") == "c");
+    REQUIRE(names("$.items[?(@.id < -9223372036854775807)]") == "d");
+    REQUIRE(names("$.items[?(@.id == 9007199254740992.0)]") == "ae");
+
+    // string literals compare byte by byte, shorter first
+    REQUIRE(names("$.items[?(@.name < 'b')]") == "a");
+    REQUIRE(names("$.items[?(@.name >= 'b')]") == "bcde");
+    REQUIRE(names("$.items[?(@.name > '')]") == "abcde");
+}
+
+TEST_CASE("TestInvalidPaths")
+{
+    for (auto expression : { "", "store", "$.", "$[", "$[0", "$[-1]", "$['a]", "$[?(@.a <> 1)]", "$[?(@.a == )]", "$.a b" }) {
+        REQUIRE_THROWS_AS(json::Path(expression), json::parse_exception);
+    }
+
+    // the largest index is how the children of objects are told apart, so no array index may be that large
+    REQUIRE_THROWS_AS(json::Path("$.a[" + std::to_string(std::numeric_limits<size_t>::max()) + "]"), json::parse_exception);
+    REQUIRE(json::Path("$.a[" + std::to_string(std::numeric_limits<size_t>::max() - 1) + "]").select(json::parse(R"({ "a" : { "b" : 1 } })").get()).empty());
+}
+
+TEST_CASE("TestStreamWriterMatchesValueWriter")
+{
+    for (auto text : { DB_JSON, GOOGLE_MARKERS_JSON, YOUTUBE_SEARCH_JSON }) {
+        auto obj = json::parse(text);
+        auto expected = writeToString(obj.get());
+
+        // the sink only ever sees a buffer's worth at a time
+        std::string output;
+        size_t largest = 0;
+        json::StreamWriter writer([&](const char* data, size_t size) {
+            largest = std::max(largest, size);
+            output.append(data, size);
+        }, 64);
+        obj->accept(&writer);
+        REQUIRE(output.size() <= expected.size());
+        writer.flush();
+        REQUIRE(output == expected);
+        REQUIRE(largest == 64);
+
+        std::ostringstream stream;
+        json::write(obj.get(), stream);
+        REQUIRE(stream.str() == expected);
+    }
+}
+
+TEST_CASE("TestValueWriterCopiesWriteOnTheirOwn")
+{
+    json::String first("first");
+    json::Bool second(true);
+
+    json::ValueWriter writer;
+    first.accept(&writer);
+    json::ValueWriter copy(writer);
+    second.accept(&copy);
+    REQUIRE(writer.getString() == "\"first\"");
+    REQUIRE(copy.getString() == "\"first\"true");
+
+    json::ValueWriter moved(std::move(copy));
+    second.accept(&moved);
+    REQUIRE(moved.getString() == "\"first\"truetrue");
+
+    writer = moved;
+    first.accept(&writer);
+    REQUIRE(writer.getString() == "\"first\"truetrue\"first\"");
+    REQUIRE(moved.getString() == "\"first\"truetrue");
+
+    std::vector<json::ValueWriter> writers(2);
+    writers.push_back(writer);
+    second.accept(&writers.back());
+    REQUIRE(writers.back().getString() == "\"first\"truetrue\"first\"true");
+}
+
+static std::string writeNumber(double value)
+{
+    json::Object obj;
+    obj.addValue("n", std::make_unique<json::Number>(value));
+    auto str = writeToString(&obj);
+    return str.substr(8, str.size() - 10); // the text between { "n" : and }
+}
+
+TEST_CASE("TestWriteShortestDoubles")
+{
+    REQUIRE(writeNumber(1.0) == "1.0");
+    REQUIRE(writeNumber(-2.0) == "-2.0");
+    REQUIRE(writeNumber(0.0) == "0.0");
+    REQUIRE(writeNumber(-0.0) == "-0.0");
+    REQUIRE(writeNumber(0.1) == "0.1");
+    REQUIRE(writeNumber(123.456) == "123.456");
+    REQUIRE(writeNumber(1e-9) == "1e-9");
+    REQUIRE(writeNumber(0.000001234) == "0.000001234");
+    REQUIRE(writeNumber(1.5e300) == "1.5e300");
+    REQUIRE(writeNumber(1e21) == "1e21");
+    REQUIRE(writeNumber(1e20) == "100000000000000000000.0");
+    REQUIRE(writeNumber(5e-324) == "5e-324");
+    REQUIRE(writeNumber(std::numeric_limits<double>::max()) == "1.7976931348623157e308");
+    REQUIRE(writeNumber(std::numeric_limits<double>::infinity()) == "null");
+
+    // every double reads back as itself and stays a double
+    std::uint64_t state = 0x9E3779B97F4A7C15ull;
+    for (int i = 0; i < 100000; ++i) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        double value;
+        std::memcpy(&value, &state, sizeof(value));
+        if (value != value || value - value != 0.0) {
+            continue;
+        }
+        auto obj = json::parse("{ \"n\" : " + writeNumber(value) + " }");
+        auto number = static_cast<json::Number*>(obj->getValue("n"));
+        REQUIRE(number->isDouble());
+        REQUIRE(number->getValue() == value);
+    }
+}
+
+TEST_CASE("TestWriterEscapesStrings")
+{
+    json::Object obj;
+    obj.addValue("plain", std::make_unique<json::String>("nothing to escape here, just a long enough run of text"));
+    obj.addValue("quo\"te", std::make_unique<json::String>("say \"hi\" \\ then\nleave\t\r\b\f"));
+    obj.addValue("control", std::make_unique<json::String>(std::string("a\x01" "b\x1f" "c\0d", 7)));
+    obj.addValue("utf8", std::make_unique<json::String>("caf\xc3\xa9 \xe2\x82\xac"));
+
+    auto str = writeToString(&obj);
+    REQUIRE(str.find(R"("quo\"te" : "say \"hi\" \\ then\nleave\t\r\b\f")") != std::string::npos);
+    REQUIRE(str.find(R"("a\u0001b\u001fc\u0000d")") != std::string::npos);
+
+    // escapes in every position of a vector's worth of characters read back as they were
+    json::Object quotes;
+    for (size_t i = 0; i < 40; ++i) {
+        std::string value(40, 'x');
+        value[i] = i % 2 == 0 ? '"' : '\\';
+        quotes.addValue("at" + std::to_string(i), std::make_unique<json::String>(value));
+    }
+
+    auto parsed = json::parse(writeToString(&quotes));
+    REQUIRE(parsed->size() == quotes.size());
+    for (auto member : quotes) {
+        REQUIRE(parsed->getStringValue(member.name) == static_cast<json::String*>(member.value)->getValue());
+    }
+}
+
+TEST_CASE("TestLoadReadsTheWholeFile")
+{
+    // a document that ends exactly at a page boundary, with nothing after its closing brace
+    std::string text = "{ \"padding\" : \"";
+    text += std::string(4096 - text.size() - 3, 'x');
+    text += "\" }";
+    REQUIRE(text.size() == 4096);
+    {
+        std::ofstream file("jsonpp-load-test.json", std::ios::binary);
+        file << text;
+    }
+    auto obj = json::load("jsonpp-load-test.json");
+    REQUIRE(obj->getStringValue("padding").size() == 4096 - 18);
+
+    {
+        std::ofstream file("jsonpp-load-test.json", std::ios::binary);
+        file << "{ \"a\" : 1 }\n{ \"a\" : 2 }\n{ \"a\" : 3 }";
+    }
+    std::int64_t sum = 0;
+    json::loadLines("jsonpp-load-test.json", [&](json::LineResult& result) {
+        sum += result.object->getInt64Value("a");
+    });
+    REQUIRE(sum == 6);
+    std::remove("jsonpp-load-test.json");
+
+    REQUIRE_THROWS_AS(json::load("jsonpp-missing-file.json"), std::runtime_error);
+}
+
+TEST_CASE("TestTokensReferToTheText")
+{
+    std::string text = R"({ "plain" : "value", "esc\"aped" : "al\"so", "nested\\" : { "in\"ner" : [ "x\"y" ] } })";
+    json::detail::Lexer lexer(text);
+    lexer.getToken();
+    auto name = lexer.getToken();
+    REQUIRE(name.value == "plain");
+    REQUIRE(!name.unescaped);
+    REQUIRE(name.value.data() == text.data() + 3);
+
+    // names with escapes survive the strings with escapes that follow them
+    for (auto options : { json::ParseOptions(), indexedOptions(), arenaOptions() }) {
+        auto obj = json::parse(text, options);
+        REQUIRE(obj->getStringValue("plain") == "value");
+        REQUIRE(obj->getStringValue("esc\"aped") == "al\"so");
+        REQUIRE(obj->getObjectValue("nested\\")->getArrayValue("in\"ner")->getStringValue(0) == "x\"y");
+    }
+}
+
+TEST_CASE("TestErrorPositionsAreWorkedOutFromOffsets")
+{
+    auto message = [](const std::string& text, const json::ParseOptions& options) {
+        try {
+            json::parse(text, options);
+        } catch (const json::parse_exception& e) {
+            return std::string(e.what());
+        }
+        return std::string();
+    };
+
+    for (auto options : { json::ParseOptions(), indexedOptions() }) {
+        REQUIRE(message("{\n  \"a\" : 1,\n  \"b\" : tru }", options) == "Expecting 'value sequence true' at line 3:12 but found ' ' instead!");
+        REQUIRE(message("{\n\n    \"a\" : [ 1, 2 }", options) == "Expecting ']' at line 3:18 but got '}' instead!");
+        REQUIRE(message("{ \"a\" : \"x\\u12\" }", options) == "Only 4 hexadecimal values accepted at line 1:14");
+    }
+}
+
+TEST_CASE("TestParseDeeplyNestedDocuments")
+{
+    auto nested = [](size_t depth) {
+        return "{ \"a\" : " + std::string(depth - 1, '[') + "1" + std::string(depth - 1, ']') + " }";
+    };
+
+    // far deeper than recursion on the call stack would allow
+    json::ParseOptions deep;
+    deep.maxDepth = 1000000;
+    RecordingHandler handler;
+    json::parse(nested(1000000), &handler, deep);
+    REQUIRE(handler.events.size() == 2 + 2 + 999999 * 2 + 2);
+
+    for (auto options : { json::ParseOptions(), indexedOptions(), arenaOptions() }) {
+        options.maxDepth = 5000;
+        auto obj = json::parse(nested(5000), options);
+        const json::Value* value = obj->getValue("a");
+        size_t depth = 1;
+        while (value->isArray()) {
+            value = static_cast<const json::Array*>(value)->getValue(0);
+            ++depth;
+        }
+        REQUIRE(depth == 5000);
+        REQUIRE_THROWS_WITH(json::parse(nested(5001), options), "The document is nested deeper than 5000 levels at line 1:5008!");
+    }
+
+    // the default limit applies to events as well, and the objects on the way count too
+    RecordingHandler limited;
+    REQUIRE_NOTHROW(json::parse(nested(1024), &limited));
+    REQUIRE_THROWS_AS(json::parse(nested(1025), &limited), json::parse_exception);
+    json::ParseOptions shallow;
+    shallow.maxDepth = 2;
+    REQUIRE_THROWS_AS(json::parse("{ \"a\" : { \"b\" : [ 1 ] } }", &limited, shallow), json::parse_exception);
+
+    // and to documents that are pushed in pieces
+    for (size_t depth : { size_t(1024), size_t(1025) }) {
+        RecordingHandler pushed;
+        json::PushParser parser(&pushed);
+        auto text = nested(depth);
+        if (depth == 1024) {
+            parser.feed(text.data(), text.size());
+            parser.finish();
+            REQUIRE(pushed.events.size() == 2 + 2 + 1023 * 2 + 2);
+        } else {
+            REQUIRE_THROWS_WITH(parser.feed(text.data(), text.size()), "The document is nested deeper than 1024 levels at line 1:1032!");
+        }
+    }
+    RecordingHandler pushed;
+    json::PushParser shallowParser(&pushed, 2);
+    const std::string text = "{ \"a\" : { \"b\" : [ 1 ] } }";
+    REQUIRE_THROWS_AS(shallowParser.feed(text.data(), text.size()), json::parse_exception);
+}
+
+TEST_CASE("TestDestroyDeeplyNestedDocuments")
+{
+    const size_t depth = 1000000;
+    std::string text = "{ \"a\" : " + std::string(depth - 1, '[') + "{ \"b\" : [ 1, {} ] }" + std::string(depth - 1, ']') + " }";
+
+    for (auto options : { json::ParseOptions(), arenaOptions() }) {
+        options.maxDepth = depth + 3;
+        auto obj = json::parse(text, options);
+        REQUIRE(obj->getArrayValue("a")->getArrayValue(0)->size() == 1);
+        obj.reset();
+    }
+
+    // built by hand and mixing objects and arrays
+    auto root = std::make_unique<json::Object>();
+    json::Object* object = root.get();
+    for (size_t i = 0; i < depth / 2; ++i) {
+        auto array = std::make_unique<json::Array>();
+        auto inner = std::make_unique<json::Object>();
+        auto next = inner.get();
+        array->addValue(std::make_unique<json::Number>(1));
+        array->addValue(std::move(inner));
+        object->addValue("x", std::move(array));
+        object = next;
+    }
+    root.reset();
+}
+
+TEST_CASE("TestReclaimerDestroysOnItsOwnThread")
+{
+    struct Tracked : public json::Null {
+        std::thread::id* destroyedOn;
+        Tracked(std::thread::id* destroyedOn) : destroyedOn(destroyedOn) {}
+        ~Tracked() { *destroyedOn = std::this_thread::get_id(); }
+    };
+
+    std::thread::id first, second;
+    {
+        json::Reclaimer reclaimer;
+        auto obj = json::parse(R"({ "a" : [ 1, 2, { "b" : "c" } ] })");
+        obj->addValue("tracked", std::make_unique<Tracked>(&first));
+        reclaimer.reclaim(std::move(obj));
+        reclaimer.wait();
+        REQUIRE(first != std::thread::id());
+        REQUIRE(first != std::this_thread::get_id());
+
+        // whatever is still queued goes before the reclaimer does
+        auto array = std::make_unique<json::Array>();
+        array->addValue(std::make_unique<Tracked>(&second));
+        reclaimer.reclaim(std::move(array));
+        reclaimer.reclaim(nullptr);
+    }
+    REQUIRE(second == first);
+
+    json::reclaimLater(json::parse(R"({ "a" : 1 })"));
+}
+
+TEST_CASE("TestTryParseReportsErrorsWithoutThrowing")
+{
+    json::StringView empty;
+    json::ParseOptions defaults;
+    REQUIRE(noexcept(json::tryParse(empty, defaults)));
+
+    auto parsed = json::tryParse(R"({ "a" : [ 1, "b" ] })");
+    REQUIRE(parsed.object != nullptr);
+    REQUIRE(parsed.error == json::ParseErrorCode::NONE);
+    REQUIRE(parsed.getMessage().empty());
+    REQUIRE(parsed.object->getArrayValue("a")->getStringValue(1) == "b");
+
+    auto thrown = [](const std::string& text, const json::ParseOptions& options) {
+        try {
+            json::parse(text, options);
+        } catch (const json::parse_exception& e) {
+            return std::string(e.what());
+        }
+        return std::string();
+    };
+
+    struct Malformed {
+        std::string text;
+        json::ParseErrorCode error;
+        size_t offset;
+    };
+    std::vector<Malformed> malformed = {
+        { "{ \"a\" : tru }", json::ParseErrorCode::UNEXPECTED_CHARACTER, 11 },
+        { "{ \"a\" : \"x\\", json::ParseErrorCode::DANGLING_ESCAPE, 10 },
+        { "{ \"a\" : \"\\u12\" }", json::ParseErrorCode::INVALID_UNICODE_ESCAPE, 12 },
+        { "{ \"a\" : @ }", json::ParseErrorCode::INVALID_TOKEN, 8 },
+        { "{ \"a\" : [ 1, 2 }", json::ParseErrorCode::UNEXPECTED_TOKEN, 15 },
+        { "{ \"a\" : 1 \"b\\\"c\" }", json::ParseErrorCode::UNEXPECTED_TOKEN, 10 },
+        { "[ 1 ]", json::ParseErrorCode::UNEXPECTED_TOKEN, 0 },
+        { "", json::ParseErrorCode::UNEXPECTED_TOKEN, 0 },
+    };
+    for (auto options : { json::ParseOptions(), indexedOptions(), arenaOptions() }) {
+        for (const auto& text : malformed) {
+            auto result = json::tryParse(text.text, options);
+            REQUIRE(result.object == nullptr);
+            REQUIRE(result.error == text.error);
+            REQUIRE(result.offset == text.offset);
+            REQUIRE(result.getMessage() == thrown(text.text, options));
+        }
+    }
+
+    json::ParseOptions shallow;
+    shallow.maxDepth = 1;
+    auto deep = json::tryParse("{ \"a\" : {} }", shallow);
+    REQUIRE(deep.error == json::ParseErrorCode::TOO_DEEP);
+    REQUIRE(deep.offset == 8);
+    REQUIRE(deep.getMessage() == "The document is nested deeper than 1 levels at line 1:9!");
+
+    REQUIRE(json::tryParse("{ \"a\" : @ }").getMessage() == "'@' is not a valid token at line 1:9!");
+    REQUIRE(json::tryParse("{ \"a\" : 1 \"b\\\"c\" }").getMessage() == "Expecting '}' at line 1:11 but got 'b\"c' instead!");
+}
+
+TEST_CASE("TestEscapesAreDecodedAndWrittenBack")
+{
+    const std::string text = R"({ "s" : "x\nyé\t\"q\"\\ \/ \b\f\r \u0001 \u20ac \uD83D\uDE00 \uD800x", "k\u00e9y\n" : 1 })";
+    const std::string decoded = "x\ny\xC3\xA9\t\"q\"\\ / \b\f\r \x01 \xE2\x82\xAC \xF0\x9F\x98\x80 \xEF\xBF\xBDx";
+    const std::string written = "{ \"s\" : \"x\\ny\xC3\xA9\\t\\\"q\\\"\\\\ / \\b\\f\\r \\u0001 \xE2\x82\xAC \xF0\x9F\x98\x80 \xEF\xBF\xBDx\", \"k\xC3\xA9y\\n\" : 1 }";
+
+    for (auto options : { json::ParseOptions(), indexedOptions(), arenaOptions() }) {
+        auto obj = json::parse(text, options);
+        REQUIRE(obj->getStringValue("s") == decoded);
+        REQUIRE(writeToString(obj.get()) == written);
+    }
+
+    // escapes and surrogate pairs split across the pieces fed to a push parser
+    json::DocumentBuilder builder;
+    json::PushParser parser(&builder);
+    for (char c : text) {
+        parser.feed(&c, 1);
+    }
+    parser.finish();
+    auto pushed = builder.release();
+    REQUIRE(writeToString(pushed.get()) == written);
+}
+
+TEST_CASE("TestTryParseReportsExceptionsAsErrors")
+{
+    const std::string text = R"({ "a" : [ 1, 2, { "b" : "a string long enough to be allocated" } ] })";
+
+    refuseAllocations = RefuseAllocations::BAD_ALLOC;
+    auto outOfMemory = json::tryParse(text);
+    refuseAllocations = RefuseAllocations::NO;
+    REQUIRE(outOfMemory.object == nullptr);
+    REQUIRE(outOfMemory.error == json::ParseErrorCode::OUT_OF_MEMORY);
+
+    refuseAllocations = RefuseAllocations::OTHER;
+    auto other = json::tryParse(text);
+    refuseAllocations = RefuseAllocations::NO;
+    REQUIRE(other.object == nullptr);
+    REQUIRE(other.error == json::ParseErrorCode::INTERNAL_ERROR);
+    REQUIRE(other.getMessage() == "The document could not be parsed because of an unexpected exception!");
+}
+
+TEST_CASE("TestParseLinesRethrowsWorkerExceptions")
+{
+    auto text = makeLines(1000);
+    json::LineOptions options;
+    options.threads = 4;
+    options.batchSize = 100;
+
+    for (bool ordered : { true, false }) {
+        options.ordered = ordered;
+        size_t calls = 0;
+        refuseAllocations = RefuseAllocations::WORKER_BAD_ALLOC;
+        REQUIRE_THROWS_AS(json::parseLines(text, [&](json::LineResult&) { ++calls; }, options), std::bad_alloc);
+        refuseAllocations = RefuseAllocations::NO;
+        REQUIRE(calls == 0);
+    }
+}